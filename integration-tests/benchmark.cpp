@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <lexer.hpp>
+
+std::string ReadFile(const std::filesystem::path& path);
+
+// How much slower iterating over tokens may be than the hand-written loop.
+// Iterating only compiles down to the same loop once the iterator is inlined,
+// so this is only checked in optimised builds, which define NDEBUG.
+constexpr double range_tolerance = 1.05;
+
+/// <summary>
+/// Lexes text with a hand-written loop over the lexer's members.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>
+/// A checksum of the tokens, so lexing can't be optimised away.
+/// </returns>
+size_t ManualLoop(std::string_view text)
+{
+    lexer lex = lexer::FromText(text);
+    size_t sum = 0;
+
+    while (lex.PeekToken() != TokenType::__eof__)
+    {
+        sum += static_cast<size_t>(lex.PeekToken()) + lex.PeekText().size()
+               + lex.PeekLine();
+        lex.Shift();
+    }
+
+    return sum;
+}
+
+/// <summary>
+/// Lexes text by iterating over the lexer's tokens.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>
+/// A checksum of the tokens, so lexing can't be optimised away.
+/// </returns>
+size_t RangeLoop(std::string_view text)
+{
+    lexer lex = lexer::FromText(text);
+    size_t sum = 0;
+
+    for (Token token : lex)
+    {
+        sum += static_cast<size_t>(token.Type) + token.Text.size() + token.Line;
+    }
+
+    return sum;
+}
+
+/// <summary>
+/// Lexes text with separate lexers on several threads at once, all sharing
+/// the lexer's tables.
+/// </summary>
+/// <param name="text">The text each lexer lexes.</param>
+/// <param name="threads">How many lexers to run.</param>
+/// <returns>
+/// A checksum of the tokens, so lexing can't be optimised away.
+/// </returns>
+size_t SeparateLexers(std::string_view text, size_t threads)
+{
+    std::vector<size_t> sums(threads);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers.emplace_back(
+            [&sums, text, i]() { sums[i] = ManualLoop(text); });
+    }
+
+    size_t sum = 0;
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers[i].join();
+        sum += sums[i];
+    }
+
+    return sum;
+}
+
+#if defined(PLEXIGLASS_BENCHMARK_PARALLEL)
+/// <summary>
+/// Lexes text on several threads at once.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <param name="threads">How many threads to lex on.</param>
+/// <param name="everyState">Whether to lex chunks from every state.</param>
+/// <returns>
+/// A checksum of the tokens, so lexing can't be optimised away.
+/// </returns>
+size_t ParallelLex(std::string_view text, size_t threads, bool everyState)
+{
+    lexer::TokenArrays tokens =
+        lexer::LexParallel(text, threads, everyState);
+    size_t sum = 0;
+
+    // Leave out the end of file token, like the loops do.
+    for (size_t i = 0; i + 1 < tokens.Types.size(); i++)
+    {
+        sum += static_cast<size_t>(tokens.Types[i]) + tokens.Lengths[i]
+               + tokens.Lines[i];
+    }
+
+    return sum;
+}
+#endif
+
+/// <summary>
+/// Time the fastest of several runs of a way of lexing text.
+/// </summary>
+/// <param name="lex">The way of lexing text.</param>
+/// <param name="text">The text to lex.</param>
+/// <param name="sum">Set to the checksum of the tokens.</param>
+/// <returns>The fastest run's time, in seconds.</returns>
+template <typename Lex>
+double Time(Lex lex, std::string_view text, size_t& sum)
+{
+    constexpr int runs = 10;
+    double fastest = 0;
+
+    for (int run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        sum = lex(text);
+        std::chrono::duration<double> time =
+            std::chrono::steady_clock::now() - start;
+
+        if (run == 0 || time.count() < fastest)
+        {
+            fastest = time.count();
+        }
+    }
+
+    return fastest;
+}
+
+/// <summary>
+/// Main entry point for the benchmark. Compares lexing a file with a
+/// hand-written loop to iterating over its tokens, times separate lexers
+/// lexing it on more and more threads at once, and lexes it on more and more
+/// threads if the lexer can.
+/// </summary>
+/// <param name="argc">Number of command line parameters.</param>
+/// <param name="argv">Command line parameters.</param>
+/// <returns>
+/// 0 if every way of lexing produced the same tokens and iterating was fast
+/// enough, 1 if not, -1 if command line parameters were bad.
+/// </returns>
+int main(int argc, char** argv)
+{
+    argc--; // discard program name
+    argv++;
+
+    if (argc != 1 && argc != 2)
+    {
+        std::cout << "Invalid arguments. Call with an input filename, and "
+                     "optionally how many megabytes to lex.\n";
+        return -1;
+    }
+
+    // Repeat the input until it's big enough to time.
+    std::string input = ReadFile(std::filesystem::path(argv[0]));
+    size_t size = (argc == 2 ? std::stoul(argv[1]) : 16) * 1024 * 1024;
+    std::string text;
+    text.reserve(size + input.size());
+    while (!input.empty() && text.size() < size)
+    {
+        text += input;
+    }
+
+    size_t manualSum, rangeSum;
+    double manual = Time(ManualLoop, text, manualSum);
+    double range = Time(RangeLoop, text, rangeSum);
+
+    std::cout << "Lexed " << text.size() << " bytes\n"
+              << "Manual loop: " << manual << " s\n"
+              << "Range loop:  " << range << " s\n"
+              << "Range / manual: " << range / manual << "\n";
+
+    if (manualSum != rangeSum)
+    {
+        std::cout << "Fail: the loops produced different tokens\n";
+        return 1;
+    }
+
+#if defined(NDEBUG)
+    if (range / manual > range_tolerance)
+    {
+        std::cout << "Fail: the range loop took more than " << range_tolerance
+                  << " times as long as the manual loop\n";
+        return 1;
+    }
+#else
+    std::cout << "Not checking range / manual, since this build isn't "
+                 "optimised\n";
+#endif
+
+    // Separate lexers share nothing they write to, so on enough cores each
+    // should take as long as a single lexer does alone.
+    size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t threads = 1; threads < cores * 2; threads *= 2)
+    {
+        threads = std::min<size_t>(threads, cores);
+
+        size_t separateSum;
+        double separate = Time(
+            [threads](std::string_view text) {
+                return SeparateLexers(text, threads);
+            },
+            text, separateSum);
+
+        std::cout << threads << " separate lexers: " << separate
+                  << " s, throughput " << threads * manual / separate
+                  << "x one lexer's\n";
+
+        if (separateSum != manualSum * threads)
+        {
+            std::cout << "Fail: " << threads
+                      << " separate lexers produced different tokens\n";
+            return 1;
+        }
+    }
+
+#if defined(PLEXIGLASS_BENCHMARK_PARALLEL)
+    for (size_t threads = 1; threads < cores * 2; threads *= 2)
+    {
+        threads = std::min<size_t>(threads, cores);
+
+        size_t linesSum, statesSum;
+        double lines = Time(
+            [threads](std::string_view text) {
+                return ParallelLex(text, threads, false);
+            },
+            text, linesSum);
+        double states = Time(
+            [threads](std::string_view text) {
+                return ParallelLex(text, threads, true);
+            },
+            text, statesSum);
+
+        std::cout << threads << " threads: " << lines << " s, speedup "
+                  << manual / lines << "; from every state: " << states
+                  << " s, speedup " << manual / states << "\n";
+
+        if (linesSum != manualSum || statesSum != manualSum)
+        {
+            std::cout << "Fail: lexing on " << threads
+                      << " threads produced different tokens\n";
+            return 1;
+        }
+    }
+#endif
+
+    return 0;
+}
@@ -1,32 +1,531 @@
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <lexer.hpp>
 
+#if defined(PLEXIGLASS_TEST_COROUTINE)
+#include <cstddef>
+#include <memory_resource>
+#endif
+
+#if defined(PLEXIGLASS_TEST_INCREMENTAL)
+#include <iterator>
+#include <random>
+#endif
+
 std::string ReadFile(const std::filesystem::path& path);
 
+// A lexer only starts in push mode when given its longest token's length.
+static_assert(!std::is_default_constructible_v<lexer>);
+static_assert(!std::is_convertible_v<size_t, lexer>);
+
+/// <summary>
+/// Runs the lexer, writing all the tokens it generates to a stream.
+/// </summary>
+/// <param name="lex">The lexer to run.</param>
+/// <param name="out">Where to write the tokens.</param>
+void RunLexer(lexer& lex, std::ostream& out)
+{
+    while (lex.PeekToken() != TokenType::__eof__)
+    {
+        out << lex.PeekLine() << ": "
+            << ToString(lex.PeekToken(), lex.PeekText()) << "\n";
+        lex.Shift();
+    }
+
+    out << lex.PeekLine() << ": " << ToString(lex.PeekToken(), lex.PeekText())
+        << "\n";
+}
+
 /// <summary>
-/// Runs the lexer, writing all the tokens it generates to an output file.
+/// Iterates over the lexer's tokens, writing them all to a stream.
 /// </summary>
-/// <param name="inputPath">Path to file to lex.</param>
-/// <param name="outputPath">Path to output file.</param>
-void RunLexer(std::string inputPath, std::string outputPath)
+/// <param name="lex">The lexer to iterate over.</param>
+/// <param name="out">Where to write the tokens.</param>
+void IterateLexer(lexer& lex, std::ostream& out)
 {
-    lexer lex(inputPath);
+    for (Token token : lex)
+    {
+        out << token.Line << ": " << ToString(token.Type, token.Text) << "\n";
+    }
 
-    std::ofstream out(outputPath);
+    out << lex.PeekLine() << ": " << ToString(lex.PeekToken(), lex.PeekText())
+        << "\n";
+}
+
+/// <summary>
+/// Checks every token's offset and column against where its text is. When
+/// lines are counted, also checks each token's line, which is the line the
+/// token ends on, while its column is where it starts.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>Whether every token's position was right.</returns>
+bool CheckPositions(std::string_view text)
+{
+    lexer lex = lexer::FromText(text);
+
+    while (true)
+    {
+        auto offset = static_cast<size_t>(lex.PeekText().data() - text.data());
+
+        // If there's no newline, rfind() returns npos, and npos + 1 is 0.
+        size_t lineStart = text.substr(0, offset).rfind('\n') + 1;
+
+        if (lex.PeekOffset() != offset
+            || lex.PeekColumn() != offset - lineStart + 1)
+        {
+            return false;
+        }
+
+#if defined(PLEXIGLASS_TEST_LINES)
+        std::string_view lexed = text.substr(0, offset + lex.PeekText().size());
+        auto newlines = std::count(lexed.begin(), lexed.end(), '\n');
+        if (lex.PeekLine() != 1 + static_cast<size_t>(newlines))
+        {
+            return false;
+        }
+#endif
+
+        if (lex.PeekToken() == TokenType::__eof__)
+        {
+            return true;
+        }
+        lex.Shift();
+    }
+}
+
+/// <summary>
+/// Checks that restoring a checkpoint goes back to the same tokens.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>Whether every token after every checkpoint was right.</returns>
+bool CheckCheckpoints(std::string_view text)
+{
+    lexer lex = lexer::FromText(text);
 
     while (lex.PeekToken() != TokenType::__eof__)
     {
+        lexer::Checkpoint checkpoint = lex.Save();
+        size_t line = lex.PeekLine();
+        std::string_view token = lex.PeekText();
+
+        lex.Shift();
+        lex.Shift();
+        lexer::Checkpoint later = lex.Save();
+        TokenType laterType = lex.PeekToken();
+        lex.Restore(checkpoint);
+
+        if (lex.PeekLine() != line || lex.PeekText().data() != token.data())
+        {
+            return false;
+        }
+
+        // Going forward again shouldn't need anything lexed again.
+        lex.Restore(later);
+        if (lex.PeekToken() != laterType)
+        {
+            return false;
+        }
+
+        lex.Restore(checkpoint);
+        lex.Shift();
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Checks that peeking ahead sees the same tokens the lexer reaches later,
+/// while streaming in small chunks.
+/// </summary>
+/// <param name="path">Path to the file to lex.</param>
+/// <returns>Whether every token peeked at was right.</returns>
+bool CheckLookahead(const std::filesystem::path& path)
+{
+    std::vector<std::pair<TokenType, std::string>> tokens;
+    {
+        lexer lex(path);
+        for (Token token : lex)
+        {
+            tokens.emplace_back(token.Type, token.Text);
+        }
+        tokens.emplace_back(lex.PeekToken(), lex.PeekText());
+    }
+
+    std::ifstream stream(path);
+    lexer lex(stream, 8, 32);
+
+    for (size_t index = 0; index < tokens.size(); index++)
+    {
+        for (size_t ahead = 0; ahead <= lexer::lookahead; ahead++)
+        {
+            // Past the end, the lexer keeps producing end of file tokens.
+            const auto& token =
+                tokens[std::min(index + ahead, tokens.size() - 1)];
+            if (lex.PeekToken(ahead) != token.first
+                || lex.PeekText(ahead) != token.second)
+            {
+                return false;
+            }
+        }
+        lex.Shift();
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Feeds text to the lexer a few bytes at a time, writing all the tokens it
+/// generates to a stream.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <param name="out">Where to write the tokens.</param>
+void PushLexer(std::string_view text, std::ostream& out)
+{
+    lexer lex(32);
+
+    auto write = [&]() {
         out << lex.PeekLine() << ": "
             << ToString(lex.PeekToken(), lex.PeekText()) << "\n";
+    };
+
+    for (size_t start = 0; start < text.size(); start += 3)
+    {
+        lex.Feed(text.substr(start, 3));
+        while (lex.Next())
+        {
+            write();
+        }
+    }
+
+    lex.Finish();
+    while (lex.Next() && lex.PeekToken() != TokenType::__eof__)
+    {
+        write();
+    }
+    write();
+}
+
+/// <summary>
+/// Lexes text a small batch of tokens at a time, writing all the tokens it
+/// generates to a stream.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <param name="out">Where to write the tokens.</param>
+void BatchLexer(std::string_view text, std::ostream& out)
+{
+    lexer lex = lexer::FromText(text);
+
+    constexpr size_t count = 5;
+    TokenType types[count];
+    size_t offsets[count], lengths[count], lines[count], columns[count];
+    TokenBatch batch{ types, offsets, lengths, lines, columns };
+
+    size_t written;
+    do
+    {
+        written = lex.LexBatch(batch, count);
+        for (size_t i = 0; i < written; i++)
+        {
+            out << lines[i] << ": "
+                << ToString(types[i], text.substr(offsets[i], lengths[i]))
+                << "\n";
+        }
+    } while (types[written - 1] != TokenType::__eof__);
+}
+
+/// <summary>
+/// Lexes text one token at a time, keeping every token.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>The text's tokens, ending with the end of file token.</returns>
+std::vector<lexer::Lexed> LexTokens(std::string_view text)
+{
+    std::vector<lexer::Lexed> tokens;
+    lexer lex = lexer::FromText(text);
+    while (true)
+    {
+        tokens.push_back({ lex.PeekToken(), lex.PeekOffset(),
+                           lex.PeekText().size(), lex.PeekLine(),
+                           lex.PeekColumn(), lex.PeekSymbol(),
+                           lex.PeekInteger(), lex.PeekFloat() });
+        if (lex.PeekToken() == TokenType::__eof__)
+        {
+            return tokens;
+        }
         lex.Shift();
     }
+}
+
+/// <summary>
+/// Checks that filtering tokens leaves just the wanted ones, where they'd be
+/// without a filter, for several filters.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>Whether every filter left the right tokens.</returns>
+bool CheckFilter(std::string_view text)
+{
+    std::vector<lexer::Lexed> all = LexTokens(text);
+    constexpr size_t types = TokenFilter().size();
+
+    // Each type on its own, every other type, and none.
+    std::vector<TokenFilter> filters;
+    for (size_t type = 0; type < types; type++)
+    {
+        filters.emplace_back().set(type);
+    }
+    TokenFilter alternate;
+    for (size_t type = 0; type < types; type += 2)
+    {
+        alternate.set(type);
+    }
+    filters.push_back(alternate);
+    filters.emplace_back();
+
+    for (const TokenFilter& filter : filters)
+    {
+        lexer lex = lexer::FromText(text);
+        lex.Filter(filter);
+
+        for (const lexer::Lexed& token : all)
+        {
+            if (!filter[static_cast<size_t>(token.Type)]
+                && token.Type != TokenType::__eof__)
+            {
+                continue;
+            }
+
+            if (lex.PeekToken() != token.Type
+                || lex.PeekOffset() != token.Offset
+                || lex.PeekText().size() != token.Length
+                || lex.PeekLine() != token.Line
+                || lex.PeekColumn() != token.Column)
+            {
+                return false;
+            }
+            lex.Shift();
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Checks that interned tokens with the same text have the same symbol, and
+/// that symbols count up from 0 in the order their text first appears.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>Whether every token's symbol was right.</returns>
+bool CheckSymbols(std::string_view text)
+{
+    lexer lex = lexer::FromText(text);
+    std::map<std::string_view, size_t> symbols;
+
+    for (Token token : lex)
+    {
+        size_t symbol = lex.PeekSymbol();
+        if (symbol == lexer::no_symbol)
+        {
+            continue;
+        }
+
+        auto found = symbols.emplace(token.Text, symbols.size()).first;
+        if (found->second != symbol)
+        {
+            return false;
+        }
+    }
+
+    for (const auto& [symbolText, symbol] : symbols)
+    {
+        if (lex.Symbols().Text(symbol) != symbolText)
+        {
+            return false;
+        }
+    }
+
+    return lex.Symbols().Size() == symbols.size();
+}
+
+#if defined(PLEXIGLASS_TEST_PARALLEL) || defined(PLEXIGLASS_TEST_INCREMENTAL)
+/// <summary>
+/// Checks that numbers' values are what their text says, and that nothing
+/// else has a value. Only the parallel test's lexer converts numbers.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>Whether every token's value was right.</returns>
+bool CheckValues(std::string_view text)
+{
+    lexer lex = lexer::FromText(text);
+
+    for (Token token : lex)
+    {
+        int64_t value = 0;
+        if (token.Type == TokenType::Number)
+        {
+            value = std::stoll(std::string(token.Text));
+        }
+
+        if (lex.PeekInteger() != value
+            || lex.PeekFloat() != static_cast<double>(value))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif
+
+#if defined(PLEXIGLASS_TEST_PARALLEL)
+/// <summary>
+/// Checks that lexing on any number of threads gets the same tokens as lexing
+/// on one, wherever the input gets split and whichever states its chunks are
+/// lexed from.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <returns>Whether every token was the same.</returns>
+bool CheckParallel(std::string_view text)
+{
+    std::vector<lexer::Lexed> tokens = LexTokens(text);
+
+    for (size_t threads = 1; threads <= 32; threads++)
+    {
+        // Odd numbers of threads lex from every state.
+        lexer::TokenArrays parallel =
+            lexer::LexParallel(text, threads / 2 + 1, threads % 2 == 1);
+        if (parallel.Types.size() != tokens.size())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < tokens.size(); i++)
+        {
+            if (parallel.Types[i] != tokens[i].Type
+                || parallel.Offsets[i] != tokens[i].Offset
+                || parallel.Lengths[i] != tokens[i].Length
+                || parallel.Lines[i] != tokens[i].Line
+                || parallel.Columns[i] != tokens[i].Column)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+#endif
+
+#if defined(PLEXIGLASS_TEST_INCREMENTAL)
+/// <summary>
+/// Makes a series of small edits to text, checking that lexing it again after
+/// each one gets the same tokens as lexing it from scratch.
+/// </summary>
+/// <param name="text">The text to start from.</param>
+/// <returns>Whether the tokens were right after every edit.</returns>
+bool CheckRelex(std::string text)
+{
+    const std::string_view pieces[] = { "/*", "*/", "\n", " ", "word", "42" };
+    std::minstd_rand random(45);
+    lexer::TokenStream stream = lexer::LexStream(text);
+
+    for (int edit = 0; edit < 500; edit++)
+    {
+        size_t offset = random() % (text.size() + 1);
+        size_t removed = std::min<size_t>(random() % 4, text.size() - offset);
+        std::string_view inserted = pieces[random() % std::size(pieces)];
+        if (random() % 2 == 0)
+        {
+            inserted = "";
+        }
+
+        text.replace(offset, removed, inserted);
+        lexer::Relex(stream, text, offset, removed, inserted.size());
+
+        std::vector<lexer::Lexed> tokens = LexTokens(text);
+        if (stream.Tokens.size() != tokens.size())
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < tokens.size(); i++)
+        {
+            const lexer::Lexed& relexed = stream.Tokens[i];
+            if (relexed.Type != tokens[i].Type
+                || relexed.Offset != tokens[i].Offset
+                || relexed.Length != tokens[i].Length
+                || relexed.Line != tokens[i].Line
+                || relexed.Column != tokens[i].Column)
+            {
+                return false;
+            }
+
+            // Symbols differ from a fresh lexer's, but not their text.
+            if (relexed.Symbol != lexer::no_symbol
+                && stream.Symbols.Text(relexed.Symbol)
+                       != text.substr(relexed.Offset, relexed.Length))
+            {
+                return false;
+            }
+            if ((relexed.Symbol == lexer::no_symbol)
+                != (tokens[i].Symbol == lexer::no_symbol))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+#endif
+
+#if defined(PLEXIGLASS_TEST_COROUTINE)
+/// <summary>
+/// Feeds text to the lexer a few bytes at a time whenever its coroutine runs
+/// out, writing all the tokens it yields to a stream.
+/// </summary>
+/// <param name="text">The text to lex.</param>
+/// <param name="out">Where to write the tokens.</param>
+void GenerateLexer(std::string_view text, std::ostream& out)
+{
+    lexer lex(32);
+
+    // The coroutine's frame comes from the stack, never the heap.
+    std::byte buffer[4096];
+    std::pmr::monotonic_buffer_resource memory(
+        buffer, sizeof(buffer), std::pmr::null_memory_resource());
+
+    size_t start = 0;
+    for (Token token : Tokens(lex, memory))
+    {
+        if (token.Type != TokenType::__nothing__)
+        {
+            out << token.Line << ": " << ToString(token.Type, token.Text)
+                << "\n";
+        }
+        else if (start < text.size())
+        {
+            lex.Feed(text.substr(start, 3));
+            start += 3;
+        }
+        else
+        {
+            lex.Finish();
+        }
+    }
 
     out << lex.PeekLine() << ": " << ToString(lex.PeekToken(), lex.PeekText())
         << "\n";
 }
+#endif
 
 /// <summary>
 /// Main entry point for lexer driver code.
@@ -48,16 +547,120 @@ int main(int argc, char** argv)
         return -1;
     }
 
-    std::string input = argv[0];
+    std::filesystem::path input = argv[0];
     std::string out = argv[1];
     std::string base = argv[2];
 
-    RunLexer(input, out);
+    {
+        lexer lex(input);
+        std::ofstream outFile(out);
+        RunLexer(lex, outFile);
+    }
 
     std::string baseContent = ReadFile(base);
     std::string outContent = ReadFile(out);
 
-    if (baseContent == outContent)
+    // Lexing the same text from memory, borrowed or owned, streaming it,
+    // pushing it in small pieces, lexing it in batches, or iterating over it
+    // should produce the same tokens. So should naming the file with a
+    // std::string or a string literal, which are paths, not text.
+    std::string text = ReadFile(input);
+    std::stringstream borrowedOut, ownedOut, streamedOut, pushedOut, batchedOut,
+        iteratedOut, namedOut, literalOut;
+
+    lexer borrowed = lexer::FromText(text);
+    RunLexer(borrowed, borrowedOut);
+
+    lexer owned = lexer::FromText(std::string(text));
+    RunLexer(owned, ownedOut);
+
+    std::string name = input.string();
+    lexer named(name);
+    RunLexer(named, namedOut);
+
+    // Every test's input is input.txt in the directory it runs in.
+    lexer literal("input.txt");
+    RunLexer(literal, literalOut);
+
+    std::ifstream stream(input);
+    lexer streamed(stream, 8, 32);
+    RunLexer(streamed, streamedOut);
+
+    PushLexer(text, pushedOut);
+    BatchLexer(text, batchedOut);
+
+    lexer iterated = lexer::FromText(text);
+    IterateLexer(iterated, iteratedOut);
+
+    if (!CheckPositions(text))
+    {
+        std::cout << "Fail\nToken offsets or columns are wrong\n";
+        return 1;
+    }
+
+    if (!CheckCheckpoints(text))
+    {
+        std::cout << "Fail\nRestored checkpoints' tokens are wrong\n";
+        return 1;
+    }
+
+    if (!CheckLookahead(input))
+    {
+        std::cout << "Fail\nTokens peeked at ahead are wrong\n";
+        return 1;
+    }
+
+    if (!CheckFilter(text))
+    {
+        std::cout << "Fail\nFiltered tokens are wrong\n";
+        return 1;
+    }
+
+    if (!CheckSymbols(text))
+    {
+        std::cout << "Fail\nInterned tokens' symbols are wrong\n";
+        return 1;
+    }
+
+#if defined(PLEXIGLASS_TEST_PARALLEL) || defined(PLEXIGLASS_TEST_INCREMENTAL)
+    if (!CheckValues(text))
+    {
+        std::cout << "Fail\nConverted tokens' values are wrong\n";
+        return 1;
+    }
+#endif
+
+#if defined(PLEXIGLASS_TEST_PARALLEL)
+    if (!CheckParallel(text))
+    {
+        std::cout << "Fail\nTokens lexed on several threads are wrong\n";
+        return 1;
+    }
+#endif
+
+#if defined(PLEXIGLASS_TEST_INCREMENTAL)
+    if (!CheckRelex(text))
+    {
+        std::cout << "Fail\nTokens lexed again after edits are wrong\n";
+        return 1;
+    }
+#endif
+
+#if defined(PLEXIGLASS_TEST_COROUTINE)
+    std::stringstream generatedOut;
+    GenerateLexer(text, generatedOut);
+    if (baseContent != generatedOut.str())
+    {
+        std::cout << "Fail\nCoroutine tokens != " << base << "\n";
+        return 1;
+    }
+#endif
+
+    if (baseContent == outContent && baseContent == borrowedOut.str()
+        && baseContent == ownedOut.str() && baseContent == streamedOut.str()
+        && baseContent == pushedOut.str() && baseContent == batchedOut.str()
+        && baseContent == iteratedOut.str() && baseContent == namedOut.str()
+        && baseContent == literalOut.str())
     {
         std::cout << "Pass\n";
         return 0;
@@ -2,6 +2,9 @@
 
 #include <map>
 #include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <error.hpp>
 
@@ -15,9 +18,14 @@ void CheckMissingNames(PatternNode node, std::set<std::string>& names);
 void CheckMissingNames(RuleNode node, std::set<std::string>& names);
 void CheckMissingNames(IdentifierSequenceNode node,
                        std::set<std::string>& names);
+void CheckRewindCycles(FileNode node);
 void CheckSelfTransitions(FileNode node);
 void CheckTransitions(FileNode lexer);
 
+// Where each state's rules that rewind transition to, and their rewinds' lines.
+using RewindGraph =
+    std::map<std::string, std::vector<std::pair<std::string, size_t>>>;
+
 bool ActionsEqual(const std::string& left, const std::string& right);
 
 /// <summary>
@@ -32,6 +40,7 @@ void Analyze(FileNode file)
     CheckIllegalActions(file);
     CheckIllegalStatements(file);
     CheckSelfTransitions(file);
+    CheckRewindCycles(file);
     CheckTransitions(file);
 }
 
@@ -227,6 +236,90 @@ void CheckSelfTransitions(FileNode node)
     }
 }
 
+/// <summary>
+/// Search for a cycle of rules that rewind, starting from a state.
+/// </summary>
+/// <param name="state">The state to search from.</param>
+/// <param name="rewinds">Where rules that rewind go.</param>
+/// <param name="visited">
+/// 1 for states being searched from, 2 for states already searched.
+/// </param>
+void CheckRewindCycles(const std::string& state,
+                       const RewindGraph& rewinds,
+                       std::map<std::string, int>& visited)
+{
+    visited[state] = 1;
+
+    auto edges = rewinds.find(state);
+    if (edges != rewinds.end())
+    {
+        for (const auto& [target, line] : edges->second)
+        {
+            if (visited[target] == 1)
+            {
+                Error(line,
+                      "'rewind' leads back to state '" + target
+                          + "' through rules that rewind, so it could "
+                            "rewind forever");
+            }
+            if (visited[target] == 0)
+            {
+                CheckRewindCycles(target, rewinds, visited);
+            }
+        }
+    }
+
+    visited[state] = 2;
+}
+
+/// <summary>
+/// Check that rules that rewind can't go around in a cycle of states. Each
+/// hands the text it matched to another state without lexing it, so around a
+/// cycle the same text could be handed on forever.
+/// </summary>
+/// <param name="node">The lexer.</param>
+void CheckRewindCycles(FileNode node)
+{
+    RewindGraph rewinds;
+
+    for (const auto& rule : node->rules)
+    {
+        std::string state = "__initial__";
+        std::string target;
+        size_t rewind = 0;
+
+        for (const auto& action : rule->actions)
+        {
+            if (action->name == "state")
+            {
+                state = action->identifier;
+            }
+            else if (action->name == "transition")
+            {
+                target = action->identifier;
+            }
+            else if (action->name == "rewind")
+            {
+                rewind = action->line;
+            }
+        }
+
+        if (rewind != 0 && !target.empty())
+        {
+            rewinds[state].push_back({ target, rewind });
+        }
+    }
+
+    std::map<std::string, int> visited;
+    for (const auto& rewind : rewinds)
+    {
+        if (visited[rewind.first] == 0)
+        {
+            CheckRewindCycles(rewind.first, rewinds, visited);
+        }
+    }
+}
+
 /// <summary>
 /// Check that non-self transitions make sense.
 /// </summary>
@@ -301,19 +394,73 @@ void CheckMissingNames(RuleNode node, std::set<std::string>& names)
 
 /// <summary>
 /// Check whether a lexer uses actions that are syntactically allowed but
-/// semantically forbidden.
+/// semantically forbidden. A rule that rewinds has to transition, or the
+/// same rule would match the same text forever. A rule that interns or
+/// converts has to produce a token with text, or there'd be nothing to intern
+/// or convert.
 /// </summary>
 /// <param name="node">The lexer.</param>
 void CheckIllegalActions(FileNode node)
 {
     for (auto& rule : node->rules)
     {
+        size_t rewind = 0;
+        size_t intern = 0;
+        size_t convert = 0;
+        bool transition = false;
+        bool produce = false;
+
         for (auto& action : rule->actions)
         {
             if (action->name == "rewind")
             {
-                Error(action->line, "'rewind' action not yet supported");
+                rewind = action->line;
             }
+            else if (action->name == "intern")
+            {
+                intern = action->line;
+            }
+            else if (action->name == "convert")
+            {
+                convert = action->line;
+                if (action->identifier != "integer"
+                    && action->identifier != "float"
+                    && action->identifier != "hex")
+                {
+                    Error(convert,
+                          "Can't convert to '" + action->identifier
+                              + "', only to integer, float or hex");
+                }
+            }
+            else if (action->name == "transition")
+            {
+                transition = true;
+            }
+            else if (action->name == "produce")
+            {
+                produce = true;
+            }
+        }
+
+        if (rewind != 0 && !transition)
+        {
+            Error(rewind, "'rewind' needs a transition to another state");
+        }
+        if (intern != 0 && !produce)
+        {
+            Error(intern, "'intern' needs a token to be produced");
+        }
+        if (intern != 0 && rewind != 0)
+        {
+            Error(intern, "'intern' can't be used with 'rewind'");
+        }
+        if (convert != 0 && !produce)
+        {
+            Error(convert, "'convert' needs a token to be produced");
+        }
+        if (convert != 0 && rewind != 0)
+        {
+            Error(convert, "'convert' can't be used with 'rewind'");
         }
     }
 }
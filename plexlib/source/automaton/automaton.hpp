@@ -0,0 +1,1779 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Compiles lexer rules into deterministic finite automata. Everything here
+// works in constant expressions, so hand-written lexers can compile their rules
+// while the program is being built, and in ordinary code, which is how the
+// generator uses it. The storage policy picks between the two.
+
+namespace plexiglass
+{
+    /// <summary>
+    /// The outcome of compiling rules into an automaton.
+    /// </summary>
+    enum class Status
+    {
+        Success,
+        Malformed,     // A pattern isn't a valid regular expression.
+        Unsupported,   // A pattern uses a feature automata can't express.
+        TooManyNodes,  // A lexer state's patterns exceed the node capacity.
+        TooManyStates, // The automaton exceeds the state capacity.
+    };
+
+    constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    // Largest number of states an automaton can have, so states fit in the
+    // 16-bit transition tables.
+    constexpr std::size_t max_states = 65535;
+
+    /// <summary>
+    /// A vector with a fixed capacity that can be used in constant
+    /// expressions. Implements the subset of std::vector the automaton
+    /// builder needs.
+    /// </summary>
+    /// <typeparam name="T">Type of the elements.</typeparam>
+    /// <typeparam name="Capacity">Most elements it can hold.</typeparam>
+    template <typename T, std::size_t Capacity>
+    class StaticVector
+    {
+    public:
+        constexpr std::size_t size() const
+        {
+            return m_size;
+        }
+
+        constexpr std::size_t max_size() const
+        {
+            return Capacity;
+        }
+
+        constexpr T& operator[](std::size_t index)
+        {
+            return m_data[index];
+        }
+
+        constexpr const T& operator[](std::size_t index) const
+        {
+            return m_data[index];
+        }
+
+        constexpr void push_back(const T& value)
+        {
+            m_data[m_size++] = value;
+        }
+
+        constexpr void pop_back()
+        {
+            m_size--;
+        }
+
+        constexpr void clear()
+        {
+            m_size = 0;
+        }
+
+        constexpr void resize(std::size_t size, const T& value = T())
+        {
+            for (std::size_t index = m_size; index < size; index++)
+            {
+                m_data[index] = value;
+            }
+            m_size = size;
+        }
+
+    private:
+        T m_data[Capacity] = {};
+        std::size_t m_size = 0;
+    };
+
+    /// <summary>
+    /// Storage for compiling rules in constant expressions.
+    /// </summary>
+    /// <typeparam name="Nodes">
+    /// Most NFA nodes the patterns of a single lexer state can need.
+    /// </typeparam>
+    /// <typeparam name="States">Most DFA states there can be.</typeparam>
+    /// <typeparam name="Rules">Most rules and lexer states.</typeparam>
+    template <std::size_t Nodes, std::size_t States, std::size_t Rules>
+    struct FixedStorage
+    {
+        static constexpr std::size_t NodeCapacity = Nodes;
+        static constexpr std::size_t StateCapacity = States;
+        static constexpr std::size_t RuleCapacity = Rules;
+
+        template <typename T, std::size_t Capacity>
+        using Vector = StaticVector<T, Capacity>;
+    };
+
+    /// <summary>
+    /// Storage for compiling rules at run time, limited only by memory.
+    /// </summary>
+    struct DynamicStorage
+    {
+        static constexpr std::size_t NodeCapacity = 0;
+        static constexpr std::size_t StateCapacity = 0;
+        static constexpr std::size_t RuleCapacity = 0;
+
+        template <typename T, std::size_t Capacity>
+        using Vector = std::vector<T>;
+    };
+
+    /// <summary>
+    /// A set of bytes.
+    /// </summary>
+    struct ByteSet
+    {
+        std::uint64_t Bits[4] = {};
+
+        constexpr void Add(unsigned char byte)
+        {
+            Bits[byte / 64] |= std::uint64_t(1) << (byte % 64);
+        }
+
+        constexpr void Add(unsigned char first, unsigned char last)
+        {
+            for (unsigned int byte = first; byte <= last; byte++)
+            {
+                Add(static_cast<unsigned char>(byte));
+            }
+        }
+
+        constexpr void Add(const ByteSet& other)
+        {
+            for (std::size_t word = 0; word < 4; word++)
+            {
+                Bits[word] |= other.Bits[word];
+            }
+        }
+
+        constexpr void Invert()
+        {
+            for (std::size_t word = 0; word < 4; word++)
+            {
+                Bits[word] = ~Bits[word];
+            }
+        }
+
+        constexpr bool Contains(unsigned char byte) const
+        {
+            return (Bits[byte / 64] >> (byte % 64)) & 1;
+        }
+    };
+
+    /// <summary>
+    /// A node in a nondeterministic finite automaton.
+    /// </summary>
+    struct NfaNode
+    {
+        ByteSet On;                              // bytes that lead to Target
+        std::size_t Target = npos;               // where those bytes lead
+        std::size_t Epsilon[2] = { npos, npos }; // where no input leads,
+                                                 // preferred edge first
+        int Accept = -1;                         // pattern accepted here
+        std::size_t Pattern = 0;                 // pattern the node is in
+    };
+
+    /// <summary>
+    /// Builds a nondeterministic finite automaton from ECMAScript-style
+    /// regular expressions using Thompson's construction.
+    ///
+    /// Supports literals, escapes, character classes, groups, alternation,
+    /// and greedy and lazy quantifiers. Anchors, lookarounds, word boundaries,
+    /// backreferences and non-ASCII \u escapes are rejected, since an
+    /// automaton over bytes can't express them.
+    ///
+    /// Epsilon edges are ordered the way std::regex backtracks: the left
+    /// alternative first, and another repetition before stopping unless the
+    /// quantifier is lazy. DfaBuilder uses the order to pick the same match.
+    /// </summary>
+    /// <typeparam name="Storage">FixedStorage or DynamicStorage.</typeparam>
+    template <typename Storage>
+    class Nfa
+    {
+    public:
+        /// <summary>
+        /// Add a pattern to the automaton.
+        /// </summary>
+        /// <param name="pattern">The regular expression to add.</param>
+        /// <param name="accept">
+        /// What to accept on matching the pattern. Lower values take priority.
+        /// </param>
+        /// <returns>Whether the pattern could be added.</returns>
+        constexpr Status Add(std::string_view pattern, int accept)
+        {
+            m_pattern = pattern;
+            m_position = 0;
+            m_status = Status::Success;
+
+            Fragment fragment = Alternation();
+
+            if (Ok() && !AtEnd())
+            {
+                Fail(Status::Malformed); // Unbalanced ')'
+            }
+            if (!Ok())
+            {
+                ErrorOffset = m_position;
+                return m_status;
+            }
+
+            Nodes[fragment.End].Accept = accept;
+            Starts.push_back(fragment.Start);
+            return Status::Success;
+        }
+
+        typename Storage::template Vector<NfaNode, Storage::NodeCapacity> Nodes;
+        typename Storage::template Vector<std::size_t, Storage::NodeCapacity>
+            Starts;                  // where each pattern starts
+        std::size_t ErrorOffset = 0; // where the last failed pattern failed
+
+    private:
+        struct Fragment
+        {
+            std::size_t Start = 0;
+            std::size_t End = 0; // never has outgoing edges
+        };
+
+        struct Escape
+        {
+            ByteSet Set;             // bytes the escape matches
+            bool IsClass = false;    // whether it's a class like \d
+            unsigned int Code = 0;   // the byte, if it isn't a class
+        };
+
+        std::string_view m_pattern;
+        std::size_t m_position = 0;
+        Status m_status = Status::Success;
+
+        constexpr bool Ok() const
+        {
+            return m_status == Status::Success;
+        }
+
+        constexpr bool AtEnd() const
+        {
+            return m_position >= m_pattern.size();
+        }
+
+        constexpr bool Peek(char c) const
+        {
+            return !AtEnd() && m_pattern[m_position] == c;
+        }
+
+        constexpr void Fail(Status status)
+        {
+            if (Ok())
+            {
+                m_status = status;
+            }
+        }
+
+        /// <summary>
+        /// Create a node with no edges.
+        /// </summary>
+        /// <returns>Index of the new node.</returns>
+        constexpr std::size_t NewNode()
+        {
+            if (Nodes.size() >= Nodes.max_size())
+            {
+                Fail(Status::TooManyNodes);
+                return 0;
+            }
+
+            Nodes.push_back(NfaNode());
+            Nodes[Nodes.size() - 1].Pattern = Starts.size();
+            return Nodes.size() - 1;
+        }
+
+        /// <summary>
+        /// Add an edge that doesn't consume input.
+        /// </summary>
+        /// <param name="from">Node the edge leaves.</param>
+        /// <param name="to">Node the edge enters.</param>
+        constexpr void Link(std::size_t from, std::size_t to)
+        {
+            if (Ok())
+            {
+                NfaNode& node = Nodes[from];
+                node.Epsilon[node.Epsilon[0] == npos ? 0 : 1] = to;
+            }
+        }
+
+        constexpr Fragment Empty()
+        {
+            std::size_t node = NewNode();
+            return { node, node };
+        }
+
+        constexpr Fragment Edge(const ByteSet& set)
+        {
+            std::size_t start = NewNode();
+            std::size_t end = NewNode();
+
+            if (Ok())
+            {
+                Nodes[start].On = set;
+                Nodes[start].Target = end;
+            }
+
+            return { start, end };
+        }
+
+        constexpr Fragment Concatenate(Fragment first, Fragment second)
+        {
+            Link(first.End, second.Start);
+            return { first.Start, second.End };
+        }
+
+        constexpr Fragment Alternate(Fragment left, Fragment right)
+        {
+            std::size_t start = NewNode();
+            std::size_t end = NewNode();
+
+            Link(start, left.Start);
+            Link(start, right.Start);
+            Link(left.End, end);
+            Link(right.End, end);
+
+            return { start, end };
+        }
+
+        /// <summary>
+        /// Link a node to where it repeats and where it stops, in the order
+        /// the quantifier prefers them.
+        /// </summary>
+        constexpr void Choose(std::size_t from,
+                              std::size_t repeat,
+                              std::size_t stop,
+                              bool lazy)
+        {
+            Link(from, lazy ? stop : repeat);
+            Link(from, lazy ? repeat : stop);
+        }
+
+        constexpr Fragment Optional(Fragment fragment, bool lazy)
+        {
+            std::size_t start = NewNode();
+            std::size_t end = NewNode();
+
+            Choose(start, fragment.Start, end, lazy);
+            Link(fragment.End, end);
+
+            return { start, end };
+        }
+
+        constexpr Fragment Star(Fragment fragment, bool lazy)
+        {
+            std::size_t start = NewNode();
+            std::size_t end = NewNode();
+
+            Choose(start, fragment.Start, end, lazy);
+            Choose(fragment.End, fragment.Start, end, lazy);
+
+            return { start, end };
+        }
+
+        constexpr Fragment Plus(Fragment fragment, bool lazy)
+        {
+            std::size_t end = NewNode();
+
+            Choose(fragment.End, fragment.Start, end, lazy);
+
+            return { fragment.Start, end };
+        }
+
+        /// <summary>
+        /// Parse alternatives separated by '|'.
+        /// </summary>
+        constexpr Fragment Alternation()
+        {
+            Fragment fragment = Sequence();
+
+            while (Ok() && Peek('|'))
+            {
+                m_position++;
+                Fragment alternative = Sequence();
+                fragment = Alternate(fragment, alternative);
+            }
+
+            return fragment;
+        }
+
+        /// <summary>
+        /// Parse quantified atoms up to the end of an alternative.
+        /// </summary>
+        constexpr Fragment Sequence()
+        {
+            Fragment fragment = Empty();
+
+            while (Ok() && !AtEnd() && !Peek('|') && !Peek(')'))
+            {
+                Fragment next = Quantified();
+                fragment = Concatenate(fragment, next);
+            }
+
+            return fragment;
+        }
+
+        /// <summary>
+        /// Parse an atom and the quantifier following it, if any.
+        /// </summary>
+        constexpr Fragment Quantified()
+        {
+            std::size_t atomStart = m_position;
+            Fragment atom = Atom();
+
+            if (!Ok() || AtEnd())
+            {
+                return atom;
+            }
+
+            std::size_t min = 0;
+            std::size_t max = npos;
+            char quantifier = m_pattern[m_position];
+
+            if (quantifier == '*')
+            {
+                m_position++;
+            }
+            else if (quantifier == '+')
+            {
+                m_position++;
+                min = 1;
+            }
+            else if (quantifier == '?')
+            {
+                m_position++;
+                max = 1;
+            }
+            else if (quantifier == '{')
+            {
+                m_position++;
+                if (!Bounds(min, max))
+                {
+                    Fail(Status::Malformed);
+                    return atom;
+                }
+            }
+            else
+            {
+                return atom;
+            }
+
+            bool lazy = Peek('?');
+            if (lazy)
+            {
+                m_position++;
+            }
+
+            if (Peek('*') || Peek('+') || Peek('?') || Peek('{'))
+            {
+                Fail(Status::Malformed); // Nothing to repeat
+                return atom;
+            }
+
+            return Repeat(atom, atomStart, min, max, lazy);
+        }
+
+        /// <summary>
+        /// Parse the bounds of a {min,max} quantifier after the '{'.
+        /// </summary>
+        /// <param name="min">Set to the minimum count.</param>
+        /// <param name="max">Set to the maximum count, or npos.</param>
+        /// <returns>Whether the bounds are valid.</returns>
+        constexpr bool Bounds(std::size_t& min, std::size_t& max)
+        {
+            if (!Number(min))
+            {
+                return false;
+            }
+
+            max = min;
+            if (Peek(','))
+            {
+                m_position++;
+                max = npos;
+                if (!Peek('}') && !Number(max))
+                {
+                    return false;
+                }
+            }
+
+            if (!Peek('}'))
+            {
+                return false;
+            }
+
+            m_position++;
+            return max >= min;
+        }
+
+        constexpr bool Number(std::size_t& value)
+        {
+            std::size_t start = m_position;
+            value = 0;
+
+            while (!AtEnd() && m_pattern[m_position] >= '0'
+                   && m_pattern[m_position] <= '9' && value <= max_states)
+            {
+                value = value * 10 + (m_pattern[m_position] - '0');
+                m_position++;
+            }
+
+            return m_position > start && value <= max_states;
+        }
+
+        /// <summary>
+        /// Repeat an atom. Every copy after the first needs its own nodes,
+        /// so the atom is parsed again for each of them.
+        /// </summary>
+        /// <param name="atom">The atom, already parsed once.</param>
+        /// <param name="atomStart">Where the atom starts.</param>
+        /// <param name="min">Minimum number of repetitions.</param>
+        /// <param name="max">Maximum number of repetitions, or npos.</param>
+        /// <param name="lazy">Whether to prefer fewer repetitions.</param>
+        constexpr Fragment Repeat(Fragment atom,
+                                  std::size_t atomStart,
+                                  std::size_t min,
+                                  std::size_t max,
+                                  bool lazy)
+        {
+            if (max == 0)
+            {
+                return Empty();
+            }
+            if (min == 0 && max == npos)
+            {
+                return Star(atom, lazy);
+            }
+
+            Fragment fragment = (min == 0) ? Optional(atom, lazy) : atom;
+            std::size_t copies = (max == npos) ? min : max;
+
+            for (std::size_t copy = 1; copy < copies && Ok(); copy++)
+            {
+                std::size_t position = m_position;
+                m_position = atomStart;
+                Fragment next = Atom();
+                m_position = position;
+
+                if (max == npos && copy == copies - 1)
+                {
+                    next = Plus(next, lazy);
+                }
+                else if (copy >= min)
+                {
+                    next = Optional(next, lazy);
+                }
+
+                fragment = Concatenate(fragment, next);
+            }
+
+            if (max == npos && copies == 1)
+            {
+                fragment = Plus(fragment, lazy);
+            }
+
+            return fragment;
+        }
+
+        /// <summary>
+        /// Parse a single character, class, or group.
+        /// </summary>
+        constexpr Fragment Atom()
+        {
+            if (AtEnd())
+            {
+                Fail(Status::Malformed);
+                return {};
+            }
+
+            char c = m_pattern[m_position++];
+            ByteSet set;
+
+            switch (c)
+            {
+            case '(':
+                if (Peek('?'))
+                {
+                    if (m_position + 1 < m_pattern.size()
+                        && m_pattern[m_position + 1] == ':')
+                    {
+                        m_position += 2;
+                    }
+                    else
+                    {
+                        Fail(Status::Unsupported); // Lookarounds
+                        return {};
+                    }
+                }
+                {
+                    Fragment group = Alternation();
+                    if (Ok() && !Peek(')'))
+                    {
+                        Fail(Status::Malformed);
+                    }
+                    m_position++;
+                    return group;
+                }
+            case '[':
+                set = Class();
+                break;
+            case '.':
+                set.Add('\n');
+                set.Add('\r');
+                set.Invert();
+                break;
+            case '\\':
+            {
+                Escape escape = ParseEscape(false);
+                set = escape.Set;
+                break;
+            }
+            case '^':
+            case '$':
+                Fail(Status::Unsupported);
+                return {};
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+                Fail(Status::Malformed); // Nothing to repeat
+                return {};
+            default:
+                set.Add(static_cast<unsigned char>(c));
+                break;
+            }
+
+            return Edge(set);
+        }
+
+        /// <summary>
+        /// Parse a character class after the '['.
+        /// </summary>
+        /// <returns>The bytes the class matches.</returns>
+        constexpr ByteSet Class()
+        {
+            ByteSet set;
+            bool negate = false;
+
+            if (Peek('^'))
+            {
+                negate = true;
+                m_position++;
+            }
+
+            while (Ok() && !Peek(']'))
+            {
+                if (AtEnd())
+                {
+                    Fail(Status::Malformed);
+                    break;
+                }
+
+                Escape first = ClassAtom();
+
+                if (Ok() && !first.IsClass && Peek('-')
+                    && m_position + 1 < m_pattern.size()
+                    && m_pattern[m_position + 1] != ']')
+                {
+                    m_position++;
+                    Escape last = ClassAtom();
+
+                    if (last.IsClass || last.Code < first.Code)
+                    {
+                        Fail(Status::Malformed);
+                        break;
+                    }
+
+                    set.Add(static_cast<unsigned char>(first.Code),
+                            static_cast<unsigned char>(last.Code));
+                }
+                else
+                {
+                    set.Add(first.Set);
+                }
+            }
+
+            m_position++; // ']'
+
+            if (negate)
+            {
+                set.Invert();
+            }
+
+            return set;
+        }
+
+        constexpr Escape ClassAtom()
+        {
+            char c = m_pattern[m_position++];
+
+            if (c == '\\')
+            {
+                return ParseEscape(true);
+            }
+
+            Escape escape;
+            escape.Code = static_cast<unsigned char>(c);
+            escape.Set.Add(static_cast<unsigned char>(c));
+            return escape;
+        }
+
+        /// <summary>
+        /// Parse an escape sequence after the '\'.
+        /// </summary>
+        /// <param name="inClass">Whether the escape is inside [].</param>
+        constexpr Escape ParseEscape(bool inClass)
+        {
+            Escape escape;
+
+            if (AtEnd())
+            {
+                Fail(Status::Malformed);
+                return escape;
+            }
+
+            char c = m_pattern[m_position++];
+            escape.Code = static_cast<unsigned char>(c);
+
+            switch (c)
+            {
+            case 'd':
+            case 'D':
+                escape.IsClass = true;
+                escape.Set.Add('0', '9');
+                break;
+            case 'w':
+            case 'W':
+                escape.IsClass = true;
+                escape.Set.Add('a', 'z');
+                escape.Set.Add('A', 'Z');
+                escape.Set.Add('0', '9');
+                escape.Set.Add('_');
+                break;
+            case 's':
+            case 'S':
+                escape.IsClass = true;
+                escape.Set.Add(' ');
+                escape.Set.Add('\t', '\r'); // \t \n \v \f \r
+                break;
+            case 't':
+                escape.Code = '\t';
+                break;
+            case 'n':
+                escape.Code = '\n';
+                break;
+            case 'r':
+                escape.Code = '\r';
+                break;
+            case 'v':
+                escape.Code = '\v';
+                break;
+            case 'f':
+                escape.Code = '\f';
+                break;
+            case '0':
+                escape.Code = 0;
+                if (Peek('0') || (!AtEnd() && m_pattern[m_position] >= '1'
+                                  && m_pattern[m_position] <= '9'))
+                {
+                    Fail(Status::Unsupported); // Octal escapes
+                }
+                break;
+            case 'b':
+                escape.Code = '\b';
+                if (!inClass)
+                {
+                    Fail(Status::Unsupported); // Word boundary
+                }
+                break;
+            case 'c':
+                if (AtEnd() || !IsLetter(m_pattern[m_position]))
+                {
+                    Fail(Status::Malformed);
+                    break;
+                }
+                escape.Code = m_pattern[m_position++] % 32;
+                break;
+            case 'x':
+                escape.Code = Hex(2);
+                break;
+            case 'u':
+                escape.Code = Hex(4);
+                if (escape.Code > 0x7F)
+                {
+                    Fail(Status::Unsupported); // Not a single byte
+                }
+                break;
+            default:
+                if (c >= '1' && c <= '9')
+                {
+                    Fail(Status::Unsupported); // Backreferences
+                }
+                else if (c == 'B' || c == 'k' || c == 'p' || c == 'P')
+                {
+                    Fail(Status::Unsupported);
+                }
+                else if (IsLetter(c) || (c >= '0' && c <= '9'))
+                {
+                    Fail(Status::Malformed);
+                }
+                break;
+            }
+
+            if (c == 'D' || c == 'W' || c == 'S')
+            {
+                escape.Set.Invert();
+            }
+            if (!escape.IsClass)
+            {
+                escape.Set.Add(static_cast<unsigned char>(escape.Code));
+            }
+
+            return escape;
+        }
+
+        constexpr unsigned int Hex(std::size_t digits)
+        {
+            unsigned int value = 0;
+
+            for (std::size_t digit = 0; digit < digits; digit++)
+            {
+                char c = AtEnd() ? '\0' : m_pattern[m_position++];
+                if (c >= '0' && c <= '9')
+                {
+                    value = value * 16 + (c - '0');
+                }
+                else if (c >= 'a' && c <= 'f')
+                {
+                    value = value * 16 + (c - 'a' + 10);
+                }
+                else if (c >= 'A' && c <= 'F')
+                {
+                    value = value * 16 + (c - 'A' + 10);
+                }
+                else
+                {
+                    Fail(Status::Malformed);
+                    return 0;
+                }
+            }
+
+            return value;
+        }
+
+        static constexpr bool IsLetter(char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        }
+    };
+
+    /// <summary>
+    /// A deterministic finite automaton for the patterns of one lexer state,
+    /// over its own byte classes. State 0 is dead: it accepts nothing and
+    /// every byte leads back to it.
+    /// </summary>
+    /// <typeparam name="Storage">FixedStorage or DynamicStorage.</typeparam>
+    template <typename Storage>
+    struct Dfa
+    {
+        std::size_t States = 0;
+        std::size_t Classes = 0;
+        std::size_t Start = 0;
+        std::uint8_t ByteClass[256] = {};
+
+        // Next[state * Classes + class] is where a byte in class leads.
+        typename Storage::template Vector<std::uint16_t,
+                                          Storage::StateCapacity * 256>
+            Next;
+        // The pattern each state accepts, or -1.
+        typename Storage::template Vector<std::int16_t, Storage::StateCapacity>
+            Accept;
+    };
+
+    /// <summary>
+    /// Split byte classes so no class straddles two classes of another
+    /// partition.
+    /// </summary>
+    /// <param name="classes">The class of each byte. Refined in place.</param>
+    /// <param name="count">The number of classes. Updated in place.</param>
+    /// <param name="other">Each byte's class in the other partition.</param>
+    constexpr void RefineClasses(std::uint8_t (&classes)[256],
+                                 std::size_t& count,
+                                 const std::uint8_t (&other)[256])
+    {
+        std::size_t pairs[256][2] = {};
+        std::size_t pairCount = 0;
+
+        for (std::size_t byte = 0; byte < 256; byte++)
+        {
+            std::size_t found = pairCount;
+            for (std::size_t pair = 0; pair < pairCount; pair++)
+            {
+                if (pairs[pair][0] == classes[byte]
+                    && pairs[pair][1] == other[byte])
+                {
+                    found = pair;
+                    break;
+                }
+            }
+
+            if (found == pairCount)
+            {
+                pairs[pairCount][0] = classes[byte];
+                pairs[pairCount][1] = other[byte];
+                pairCount++;
+            }
+
+            classes[byte] = static_cast<std::uint8_t>(found);
+        }
+
+        count = pairCount;
+    }
+
+    /// <summary>
+    /// Group bytes that every edge of an NFA treats the same way.
+    /// </summary>
+    /// <param name="nfa">The NFA.</param>
+    /// <param name="classes">Set to the class of each byte.</param>
+    /// <param name="count">Set to the number of classes.</param>
+    template <typename Storage>
+    constexpr void ClassifyBytes(const Nfa<Storage>& nfa,
+                                 std::uint8_t (&classes)[256],
+                                 std::size_t& count)
+    {
+        for (std::size_t byte = 0; byte < 256; byte++)
+        {
+            classes[byte] = 0;
+        }
+        count = 1;
+
+        for (std::size_t node = 0; node < nfa.Nodes.size(); node++)
+        {
+            if (nfa.Nodes[node].Target == npos)
+            {
+                continue;
+            }
+
+            std::uint8_t membership[256] = {};
+            for (std::size_t byte = 0; byte < 256; byte++)
+            {
+                membership[byte] = nfa.Nodes[node].On.Contains(
+                    static_cast<unsigned char>(byte));
+            }
+
+            RefineClasses(classes, count, membership);
+        }
+    }
+
+    /// <summary>
+    /// Converts an NFA to a minimal DFA by subset construction followed by
+    /// partition refinement.
+    ///
+    /// Each DFA state is a list of NFA nodes in priority order, the order a
+    /// backtracking matcher would try them in. Once a pattern accepts, its
+    /// nodes further down the list are dropped, since std::regex would never
+    /// backtrack into them. The longest match the DFA finds for a pattern is
+    /// then the match std::regex finds.
+    /// </summary>
+    /// <typeparam name="Storage">FixedStorage or DynamicStorage.</typeparam>
+    template <typename Storage>
+    class DfaBuilder
+    {
+    public:
+        constexpr DfaBuilder(const Nfa<Storage>& nfa, Dfa<Storage>& dfa)
+            : m_nfa(nfa)
+            , m_dfa(dfa)
+            , m_words((nfa.Nodes.size() + 63) / 64)
+        {
+        }
+
+        /// <summary>
+        /// Build the DFA.
+        /// </summary>
+        /// <returns>Whether the DFA fit in the available storage.</returns>
+        constexpr Status Build()
+        {
+            ClassifyBytes(m_nfa, m_dfa.ByteClass, m_dfa.Classes);
+
+            std::size_t representatives[256] = {};
+            for (std::size_t byte = 256; byte-- > 0;)
+            {
+                representatives[m_dfa.ByteClass[byte]] = byte;
+            }
+
+            m_dfa.States = 0;
+            m_dfa.Next.clear();
+            m_dfa.Accept.clear();
+            m_lists.clear();
+            m_offsets.clear();
+            m_offsets.push_back(0);
+
+            // The dead state is the empty list of NFA nodes.
+            Clear();
+            AddState();
+
+            // The start state is the start of every pattern, plus whatever
+            // they reach without consuming input.
+            Clear();
+            for (std::size_t start = 0; start < m_nfa.Starts.size(); start++)
+            {
+                Visit(m_nfa.Starts[start]);
+            }
+            if (!AddState())
+            {
+                return Status::TooManyStates;
+            }
+            m_dfa.Start = 1;
+
+            for (std::size_t state = 1; state < m_dfa.States; state++)
+            {
+                for (std::size_t c = 0; c < m_dfa.Classes; c++)
+                {
+                    Move(state, static_cast<unsigned char>(representatives[c]));
+
+                    std::size_t target = Find();
+                    if (target == npos)
+                    {
+                        if (!AddState())
+                        {
+                            return Status::TooManyStates;
+                        }
+                        target = m_dfa.States - 1;
+                    }
+
+                    m_dfa.Next[state * m_dfa.Classes + c] =
+                        static_cast<std::uint16_t>(target);
+                }
+            }
+
+            Minimize();
+            return Status::Success;
+        }
+
+    private:
+        const Nfa<Storage>& m_nfa;
+        Dfa<Storage>& m_dfa;
+        std::size_t m_words;
+
+        // The NFA nodes in each DFA state, highest priority first. State s
+        // holds m_lists[m_offsets[s]] up to m_lists[m_offsets[s + 1]].
+        typename Storage::template Vector<
+            std::size_t,
+            Storage::StateCapacity * Storage::NodeCapacity>
+            m_lists;
+        typename Storage::template Vector<std::size_t,
+                                          Storage::StateCapacity + 1>
+            m_offsets;
+        // The list being built, the nodes it has seen, and the patterns
+        // that have accepted in it.
+        typename Storage::template Vector<std::size_t, Storage::NodeCapacity>
+            m_list;
+        typename Storage::template Vector<std::uint64_t,
+                                          (Storage::NodeCapacity + 63) / 64>
+            m_seen;
+        typename Storage::template Vector<std::uint8_t, Storage::NodeCapacity>
+            m_accepted;
+        // Every node pushes at most two more, so this can't overflow.
+        typename Storage::template Vector<std::size_t,
+                                          Storage::NodeCapacity * 2 + 1>
+            m_stack;
+
+        constexpr void Clear()
+        {
+            m_list.clear();
+            m_seen.clear();
+            m_seen.resize(m_words, 0);
+            m_accepted.clear();
+            m_accepted.resize(m_nfa.Starts.size(), 0);
+            m_stack.clear();
+        }
+
+        /// <summary>
+        /// Append a node and everything it reaches without consuming input
+        /// to the list, depth first so the preferred edge comes first.
+        /// </summary>
+        constexpr void Visit(std::size_t root)
+        {
+            m_stack.push_back(root);
+
+            while (m_stack.size() > 0)
+            {
+                std::size_t index = m_stack[m_stack.size() - 1];
+                m_stack.pop_back();
+
+                if ((m_seen[index / 64] >> (index % 64)) & 1)
+                {
+                    continue;
+                }
+                m_seen[index / 64] |= std::uint64_t(1) << (index % 64);
+
+                const NfaNode& node = m_nfa.Nodes[index];
+                if (m_accepted[node.Pattern])
+                {
+                    continue;
+                }
+
+                // Nodes with only epsilon edges are already followed, so
+                // only nodes that consume input or accept are kept.
+                if (node.Target != npos || node.Accept >= 0)
+                {
+                    m_list.push_back(index);
+                }
+                if (node.Accept >= 0)
+                {
+                    m_accepted[node.Pattern] = 1;
+                }
+
+                for (std::size_t edge = 2; edge-- > 0;)
+                {
+                    if (node.Epsilon[edge] != npos)
+                    {
+                        m_stack.push_back(node.Epsilon[edge]);
+                    }
+                }
+            }
+        }
+
+        /// <summary>
+        /// Set the list to the nodes a byte leads to from a DFA state.
+        /// </summary>
+        constexpr void Move(std::size_t state, unsigned char byte)
+        {
+            Clear();
+
+            for (std::size_t item = m_offsets[state];
+                 item < m_offsets[state + 1];
+                 item++)
+            {
+                const NfaNode& node = m_nfa.Nodes[m_lists[item]];
+                if (node.Target != npos && node.On.Contains(byte))
+                {
+                    Visit(node.Target);
+                }
+            }
+        }
+
+        /// <summary>
+        /// Find the DFA state for the list.
+        /// </summary>
+        /// <returns>The state, or npos if there isn't one yet.</returns>
+        constexpr std::size_t Find() const
+        {
+            for (std::size_t state = 0; state < m_dfa.States; state++)
+            {
+                std::size_t offset = m_offsets[state];
+                bool same = m_offsets[state + 1] - offset == m_list.size();
+                for (std::size_t item = 0; item < m_list.size() && same; item++)
+                {
+                    same = m_lists[offset + item] == m_list[item];
+                }
+                if (same)
+                {
+                    return state;
+                }
+            }
+
+            return npos;
+        }
+
+        /// <summary>
+        /// Add a DFA state for the list.
+        /// </summary>
+        /// <returns>Whether there was room for the state.</returns>
+        constexpr bool AddState()
+        {
+            if (m_dfa.Accept.size() >= m_dfa.Accept.max_size()
+                && Storage::StateCapacity > 0)
+            {
+                return false;
+            }
+            if (m_dfa.States >= max_states)
+            {
+                return false;
+            }
+
+            int accept = -1;
+            for (std::size_t item = 0; item < m_list.size(); item++)
+            {
+                int nodeAccept = m_nfa.Nodes[m_list[item]].Accept;
+                if (nodeAccept >= 0 && (accept < 0 || nodeAccept < accept))
+                {
+                    accept = nodeAccept;
+                }
+                m_lists.push_back(m_list[item]);
+            }
+            m_offsets.push_back(m_lists.size());
+
+            m_dfa.Accept.push_back(static_cast<std::int16_t>(accept));
+            m_dfa.States++;
+            m_dfa.Next.resize(m_dfa.States * m_dfa.Classes, 0);
+            return true;
+        }
+
+        /// <summary>
+        /// Merge states that behave identically. Starts by separating states
+        /// that accept different patterns, then splits groups until every
+        /// member of a group leads to the same groups. The dead state is
+        /// seen first, so it stays state 0.
+        /// </summary>
+        constexpr void Minimize()
+        {
+            typename Storage::template Vector<std::size_t,
+                                              Storage::StateCapacity>
+                groups, refined, representatives;
+            groups.resize(m_dfa.States, 0);
+            refined.resize(m_dfa.States, 0);
+
+            std::size_t count = 0;
+            for (std::size_t state = 0; state < m_dfa.States; state++)
+            {
+                std::size_t group = 0;
+                while (group < count
+                       && m_dfa.Accept[representatives[group]]
+                              != m_dfa.Accept[state])
+                {
+                    group++;
+                }
+                if (group == count)
+                {
+                    representatives.push_back(state);
+                    count++;
+                }
+                groups[state] = group;
+            }
+
+            while (true)
+            {
+                representatives.clear();
+
+                for (std::size_t state = 0; state < m_dfa.States; state++)
+                {
+                    std::size_t group = 0;
+                    while (group < representatives.size()
+                           && !Equivalent(groups, representatives[group],
+                                          state))
+                    {
+                        group++;
+                    }
+                    if (group == representatives.size())
+                    {
+                        representatives.push_back(state);
+                    }
+                    refined[state] = group;
+                }
+
+                bool stable = representatives.size() == count;
+                count = representatives.size();
+                for (std::size_t state = 0; state < m_dfa.States; state++)
+                {
+                    groups[state] = refined[state];
+                }
+
+                if (stable)
+                {
+                    break;
+                }
+            }
+
+            // Representatives are in increasing order, so each group's row
+            // can be written over rows that have already been read.
+            for (std::size_t group = 0; group < count; group++)
+            {
+                std::size_t state = representatives[group];
+                for (std::size_t c = 0; c < m_dfa.Classes; c++)
+                {
+                    std::size_t target = m_dfa.Next[state * m_dfa.Classes + c];
+                    m_dfa.Next[group * m_dfa.Classes + c] =
+                        static_cast<std::uint16_t>(groups[target]);
+                }
+                m_dfa.Accept[group] = m_dfa.Accept[state];
+            }
+
+            m_dfa.Start = groups[m_dfa.Start];
+            m_dfa.States = count;
+            m_dfa.Next.resize(count * m_dfa.Classes);
+            m_dfa.Accept.resize(count);
+        }
+
+        template <typename Groups>
+        constexpr bool Equivalent(const Groups& groups,
+                                  std::size_t left,
+                                  std::size_t right) const
+        {
+            if (groups[left] != groups[right])
+            {
+                return false;
+            }
+
+            for (std::size_t c = 0; c < m_dfa.Classes; c++)
+            {
+                std::size_t leftTarget = m_dfa.Next[left * m_dfa.Classes + c];
+                std::size_t rightTarget =
+                    m_dfa.Next[right * m_dfa.Classes + c];
+                if (groups[leftTarget] != groups[rightTarget])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+
+    /// <summary>
+    /// The automata for every lexer state, combined into one set of tables
+    /// over shared byte classes. State 0 is dead.
+    /// </summary>
+    /// <typeparam name="Storage">FixedStorage or DynamicStorage.</typeparam>
+    template <typename Storage>
+    struct Automaton
+    {
+        Status Result = Status::Success;
+        std::size_t ErrorRule = 0;   // rule that couldn't be compiled
+        std::size_t ErrorOffset = 0; // where in its pattern it failed
+
+        std::size_t States = 0;
+        std::size_t Classes = 1;
+        std::uint8_t ByteClass[256] = {};
+
+        // Next[state * Classes + class] is where a byte in class leads.
+        typename Storage::template Vector<std::uint16_t,
+                                          Storage::StateCapacity * 256>
+            Next;
+        // Which of the current lexer state's rules each state accepts, or -1.
+        typename Storage::template Vector<std::int16_t, Storage::StateCapacity>
+            Accept;
+        // Where each lexer state's automaton starts.
+        typename Storage::template Vector<std::size_t, Storage::RuleCapacity>
+            Start;
+        // Where each lexer state's rules start in Rules. Has an extra entry
+        // marking the end of the last lexer state's rules.
+        typename Storage::template Vector<std::size_t, Storage::RuleCapacity>
+            RuleBase;
+        // Indexes of the original rules, grouped by lexer state.
+        typename Storage::template Vector<std::size_t, Storage::RuleCapacity>
+            Rules;
+    };
+
+    /// <summary>
+    /// Add a lexer state's DFA to the combined automaton.
+    /// </summary>
+    /// <param name="automaton">
+    /// The combined automaton. Its byte classes must already refine the
+    /// DFA's.
+    /// </param>
+    /// <param name="dfa">The DFA to add.</param>
+    /// <param name="start">Set to where the DFA starts.</param>
+    /// <returns>Whether there was room for the DFA.</returns>
+    template <typename Storage>
+    constexpr Status Append(Automaton<Storage>& automaton,
+                            const Dfa<Storage>& dfa,
+                            std::size_t& start)
+    {
+        // The DFA's dead state becomes the shared dead state, and the rest of
+        // its states go at the end.
+        std::size_t added = dfa.States - 1;
+        std::size_t offset = automaton.States - 1;
+
+        if (automaton.States + added > max_states
+            || (Storage::StateCapacity > 0
+                && automaton.States + added > Storage::StateCapacity))
+        {
+            return Status::TooManyStates;
+        }
+
+        std::size_t representatives[256] = {};
+        for (std::size_t byte = 256; byte-- > 0;)
+        {
+            representatives[automaton.ByteClass[byte]] = byte;
+        }
+
+        for (std::size_t state = 1; state < dfa.States; state++)
+        {
+            for (std::size_t c = 0; c < automaton.Classes; c++)
+            {
+                std::size_t local = dfa.ByteClass[representatives[c]];
+                std::size_t target = dfa.Next[state * dfa.Classes + local];
+                automaton.Next.push_back(static_cast<std::uint16_t>(
+                    target == 0 ? 0 : offset + target));
+            }
+            automaton.Accept.push_back(dfa.Accept[state]);
+        }
+
+        automaton.States += added;
+        start = dfa.Start == 0 ? 0 : offset + dfa.Start;
+        return Status::Success;
+    }
+
+    /// <summary>
+    /// Find an earlier lexer state whose rules match the same patterns in
+    /// the same order, so the two can share an automaton.
+    /// </summary>
+    /// <returns>The earlier lexer state, or npos if there isn't one.</returns>
+    template <typename Storage, typename Rules>
+    constexpr std::size_t
+    FindEquivalentState(const Automaton<Storage>& automaton,
+                        const Rules& rules,
+                        std::size_t state)
+    {
+        std::size_t base = automaton.RuleBase[state];
+        std::size_t count = automaton.RuleBase[state + 1] - base;
+
+        for (std::size_t other = 0; other < state; other++)
+        {
+            std::size_t otherBase = automaton.RuleBase[other];
+            if (automaton.RuleBase[other + 1] - otherBase != count)
+            {
+                continue;
+            }
+
+            bool same = true;
+            for (std::size_t rule = 0; rule < count && same; rule++)
+            {
+                same = rules[automaton.Rules[base + rule]].Pattern
+                       == rules[automaton.Rules[otherBase + rule]].Pattern;
+            }
+            if (same)
+            {
+                return other;
+            }
+        }
+
+        return npos;
+    }
+
+    /// <summary>
+    /// Build an NFA for a lexer state's patterns.
+    /// </summary>
+    /// <returns>Whether the patterns could be compiled.</returns>
+    template <typename Storage, typename Rules>
+    constexpr Status BuildNfa(Automaton<Storage>& automaton,
+                              const Rules& rules,
+                              std::size_t state,
+                              Nfa<Storage>& nfa)
+    {
+        std::size_t base = automaton.RuleBase[state];
+        std::size_t end = automaton.RuleBase[state + 1];
+
+        for (std::size_t rule = base; rule < end; rule++)
+        {
+            std::size_t index = automaton.Rules[rule];
+            Status status = nfa.Add(rules[index].Pattern,
+                                    static_cast<int>(rule - base));
+            if (status != Status::Success)
+            {
+                automaton.ErrorRule = index;
+                automaton.ErrorOffset = nfa.ErrorOffset;
+                return status;
+            }
+        }
+
+        return Status::Success;
+    }
+
+    /// <summary>
+    /// A cache of lexer states' DFAs that never has anything in it.
+    ///
+    /// Build takes any type with the same members. Find returns a DFA
+    /// previously built for the lexer state's patterns, or nullptr. Store is
+    /// given every DFA Build had to build itself.
+    /// </summary>
+    struct NoCache
+    {
+        template <typename Storage, typename Rules>
+        constexpr const Dfa<Storage>* Find(const Automaton<Storage>&,
+                                           const Rules&,
+                                           std::size_t)
+        {
+            return nullptr;
+        }
+
+        template <typename Storage, typename Rules>
+        constexpr void Store(const Automaton<Storage>&,
+                             const Rules&,
+                             std::size_t,
+                             const Dfa<Storage>&)
+        {
+        }
+    };
+
+    /// <summary>
+    /// Compile rules into an automaton, reusing lexer states' DFAs from a
+    /// cache where possible.
+    /// </summary>
+    /// <typeparam name="Storage">FixedStorage or DynamicStorage.</typeparam>
+    /// <param name="rules">
+    /// The rules, in priority order. Each needs an Active lexer state that
+    /// converts to an index, and a Pattern.
+    /// </param>
+    /// <param name="lexerStates">How many lexer states there are.</param>
+    /// <param name="cache">
+    /// Where to look for DFAs before building them. See NoCache.
+    /// </param>
+    /// <returns>The automaton, or the reason it couldn't be built.</returns>
+    template <typename Storage, typename Rules, typename Cache>
+    constexpr Automaton<Storage>
+    Build(const Rules& rules, std::size_t lexerStates, Cache& cache)
+    {
+        Automaton<Storage> automaton;
+
+        for (std::size_t state = 0; state < lexerStates; state++)
+        {
+            automaton.RuleBase.push_back(automaton.Rules.size());
+            for (std::size_t rule = 0; rule < rules.size(); rule++)
+            {
+                if (static_cast<std::size_t>(rules[rule].Active) == state)
+                {
+                    automaton.Rules.push_back(rule);
+                }
+            }
+        }
+        automaton.RuleBase.push_back(automaton.Rules.size());
+
+        // Every lexer state's byte classes have to be known before any
+        // automaton can be added, since they all share one table.
+        for (std::size_t state = 0; state < lexerStates; state++)
+        {
+            if (FindEquivalentState(automaton, rules, state) != npos)
+            {
+                continue;
+            }
+
+            // A DFA's byte classes are exactly its NFA's.
+            const Dfa<Storage>* cached = cache.Find(automaton, rules, state);
+            if (cached != nullptr)
+            {
+                RefineClasses(
+                    automaton.ByteClass, automaton.Classes, cached->ByteClass);
+                continue;
+            }
+
+            Nfa<Storage> nfa;
+            automaton.Result = BuildNfa(automaton, rules, state, nfa);
+            if (automaton.Result != Status::Success)
+            {
+                return automaton;
+            }
+
+            std::uint8_t classes[256] = {};
+            std::size_t count = 0;
+            ClassifyBytes(nfa, classes, count);
+            RefineClasses(automaton.ByteClass, automaton.Classes, classes);
+        }
+
+        automaton.States = 1;
+        automaton.Next.resize(automaton.Classes, 0);
+        automaton.Accept.push_back(-1);
+
+        for (std::size_t state = 0; state < lexerStates; state++)
+        {
+            std::size_t equivalent =
+                FindEquivalentState(automaton, rules, state);
+            if (equivalent != npos)
+            {
+                automaton.Start.push_back(automaton.Start[equivalent]);
+                continue;
+            }
+
+            std::size_t start = 0;
+            const Dfa<Storage>* cached = cache.Find(automaton, rules, state);
+            if (cached != nullptr)
+            {
+                automaton.Result = Append(automaton, *cached, start);
+            }
+            else
+            {
+                Nfa<Storage> nfa;
+                Dfa<Storage> dfa;
+
+                BuildNfa(automaton, rules, state, nfa);
+                automaton.Result = DfaBuilder<Storage>(nfa, dfa).Build();
+                if (automaton.Result == Status::Success)
+                {
+                    cache.Store(automaton, rules, state, dfa);
+                    automaton.Result = Append(automaton, dfa, start);
+                }
+            }
+            if (automaton.Result != Status::Success)
+            {
+                automaton.ErrorRule =
+                    automaton.Rules[automaton.RuleBase[state]];
+                return automaton;
+            }
+
+            automaton.Start.push_back(start);
+        }
+
+        return automaton;
+    }
+
+    /// <summary>
+    /// Compile rules into an automaton.
+    /// </summary>
+    /// <typeparam name="Storage">FixedStorage or DynamicStorage.</typeparam>
+    /// <param name="rules">
+    /// The rules, in priority order. Each needs an Active lexer state that
+    /// converts to an index, and a Pattern.
+    /// </param>
+    /// <param name="lexerStates">How many lexer states there are.</param>
+    /// <returns>The automaton, or the reason it couldn't be built.</returns>
+    template <typename Storage, typename Rules>
+    constexpr Automaton<Storage> Build(const Rules& rules,
+                                       std::size_t lexerStates)
+    {
+        NoCache cache;
+        return Build<Storage>(rules, lexerStates, cache);
+    }
+
+    /// <summary>
+    /// A rule in a hand-written lexer. Mirrors the rules of generated
+    /// lexers.
+    /// </summary>
+    template <typename TokenType, typename LexerState>
+    struct Rule
+    {
+        LexerState Active;        // state this rule is active in
+        std::string_view Pattern; // regex to match
+        LexerState Transition;    // state this rule transitions to
+        TokenType Token;          // what gets produced
+        int Increment;            // how much to increment the line number by
+    };
+
+    /// <summary>
+    /// What happens when a rule matches.
+    /// </summary>
+    template <typename TokenType, typename LexerState>
+    struct Action
+    {
+        LexerState Transition = LexerState::__initial__;
+        TokenType Token = TokenType::__nothing__;
+        int Increment = 0;
+    };
+
+    /// <summary>
+    /// Compiled rules, sized exactly for the automaton.
+    /// </summary>
+    template <typename Token,
+              typename State,
+              std::size_t StateCount,
+              std::size_t ClassCount,
+              std::size_t RuleCount>
+    struct Tables
+    {
+        using TokenType = Token;
+        using LexerState = State;
+
+        static constexpr std::size_t LexerStates =
+            static_cast<std::size_t>(State::__jail__) + 1;
+        static constexpr std::size_t States = StateCount;
+        static constexpr std::size_t Classes = ClassCount;
+
+        std::uint8_t ByteClass[256] = {};
+        std::uint16_t Next[StateCount * ClassCount] = {};
+        std::int16_t Accept[StateCount] = {};
+        std::uint16_t Start[LexerStates] = {};
+        std::uint16_t RuleBase[LexerStates] = {};
+        Action<Token, State> Actions[RuleCount] = {};
+    };
+
+    /// <summary>
+    /// Fails compilation with the reason rules couldn't be compiled in its
+    /// template arguments.
+    /// </summary>
+    /// <typeparam name="Result">Why the rules couldn't be compiled.</typeparam>
+    /// <typeparam name="Rule">Index of the rule that failed.</typeparam>
+    /// <typeparam name="Offset">Where in its pattern it failed.</typeparam>
+    template <Status Result, std::size_t Rule, std::size_t Offset>
+    constexpr int CompilationFailed()
+    {
+        static_assert(Result == Status::Success,
+                      "A rule couldn't be compiled into an automaton. See the "
+                      "template arguments of CompilationFailed for why, which "
+                      "rule, and where in its pattern.");
+        return 0;
+    }
+
+    /// <summary>
+    /// Compile a hand-written lexer's rules into tables while the program is
+    /// being compiled.
+    ///
+    /// TokenType must have __eof__, __jam__, and __nothing__ enumerators.
+    /// LexerState must start with __initial__ and end with __jail__. These
+    /// are the same conventions generated lexers follow.
+    /// </summary>
+    /// <typeparam name="NodeCapacity">
+    /// Most NFA nodes one lexer state's patterns can need.
+    /// </typeparam>
+    /// <typeparam name="StateCapacity">
+    /// Most DFA states the automaton can have.
+    /// </typeparam>
+    /// <param name="description">
+    /// A lambda returning a std::array of Rule, in priority order.
+    /// </param>
+    /// <returns>The compiled tables.</returns>
+    template <std::size_t NodeCapacity = 256,
+              std::size_t StateCapacity = 64,
+              typename Description>
+    constexpr auto Compile(Description description)
+    {
+        constexpr auto rules = description();
+
+        using RuleType = typename decltype(rules)::value_type;
+        using TokenType = decltype(RuleType::Token);
+        using LexerState = decltype(RuleType::Active);
+
+        constexpr std::size_t lexerStates =
+            static_cast<std::size_t>(LexerState::__jail__) + 1;
+        using Storage = FixedStorage<NodeCapacity, StateCapacity,
+                                     rules.size() + lexerStates + 1>;
+
+        constexpr auto automaton = Build<Storage>(rules, lexerStates);
+
+        if constexpr (automaton.Result != Status::Success)
+        {
+            return CompilationFailed<automaton.Result, automaton.ErrorRule,
+                                     automaton.ErrorOffset>();
+        }
+        else
+        {
+            Tables<TokenType, LexerState, automaton.States, automaton.Classes,
+                   rules.size()>
+                tables;
+
+            for (std::size_t byte = 0; byte < 256; byte++)
+            {
+                tables.ByteClass[byte] = automaton.ByteClass[byte];
+            }
+            for (std::size_t entry = 0; entry < automaton.Next.size(); entry++)
+            {
+                tables.Next[entry] = automaton.Next[entry];
+            }
+            for (std::size_t state = 0; state < automaton.States; state++)
+            {
+                tables.Accept[state] = automaton.Accept[state];
+            }
+            for (std::size_t state = 0; state < lexerStates; state++)
+            {
+                tables.Start[state] =
+                    static_cast<std::uint16_t>(automaton.Start[state]);
+                tables.RuleBase[state] =
+                    static_cast<std::uint16_t>(automaton.RuleBase[state]);
+            }
+            for (std::size_t rule = 0; rule < rules.size(); rule++)
+            {
+                const RuleType& source = rules[automaton.Rules[rule]];
+                tables.Actions[rule].Transition = source.Transition;
+                tables.Actions[rule].Token = source.Token;
+                tables.Actions[rule].Increment = source.Increment;
+            }
+
+            return tables;
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include <automaton/automaton.hpp>
+
+namespace plexiglass
+{
+    /// <summary>
+    /// Runs tables made by Compile over a buffer. Takes the longest match
+    /// at each position, preferring earlier rules on ties, like generated
+    /// lexers.
+    /// </summary>
+    /// <typeparam name="TablesType">Tables returned by Compile.</typeparam>
+    template <typename TablesType>
+    class Lexer
+    {
+    public:
+        using TokenType = typename TablesType::TokenType;
+        using LexerState = typename TablesType::LexerState;
+
+        /// <summary>
+        /// Lex a buffer.
+        /// </summary>
+        /// <param name="tables">
+        /// The compiled rules. Must outlive the lexer.
+        /// </param>
+        /// <param name="input">
+        /// The text to lex. Must outlive the lexer.
+        /// </param>
+        Lexer(const TablesType& tables, std::string_view input)
+            : m_tables(&tables)
+            , m_view(input)
+            , m_state(LexerState::__initial__)
+            , m_line(1)
+            , m_type(TokenType::__nothing__)
+        {
+            Shift();
+        }
+
+        /// <summary>
+        /// Get the line the next token is on.
+        /// </summary>
+        std::size_t PeekLine() const
+        {
+            return m_line;
+        }
+
+        /// <summary>
+        /// Get the type of the next token.
+        /// </summary>
+        TokenType PeekToken() const
+        {
+            return m_type;
+        }
+
+        /// <summary>
+        /// Get the text of the next token.
+        /// </summary>
+        std::string_view PeekText() const
+        {
+            return m_text;
+        }
+
+        /// <summary>
+        /// Advance to the next token.
+        /// </summary>
+        void Shift()
+        {
+            m_type = TokenType::__nothing__;
+            while (m_type == TokenType::__nothing__)
+            {
+                ShiftHelper();
+            }
+        }
+
+    private:
+        const TablesType* m_tables;
+        std::string_view m_view;
+        LexerState m_state;
+        std::size_t m_line;
+        TokenType m_type;
+        std::string_view m_text;
+
+        void ShiftHelper()
+        {
+            if (m_view.empty())
+            {
+                m_type = TokenType::__eof__;
+                m_text = m_view;
+                return;
+            }
+
+            const TablesType& tables = *m_tables;
+            std::size_t lexerState = static_cast<std::size_t>(m_state);
+            std::size_t state = tables.Start[lexerState];
+            std::size_t length = 0;
+            std::size_t matched = 0;
+            int accept = -1;
+
+            while (state != 0 && length < m_view.size())
+            {
+                unsigned char byte = static_cast<unsigned char>(m_view[length]);
+                state = tables.Next[state * TablesType::Classes
+                                    + tables.ByteClass[byte]];
+                length++;
+
+                if (tables.Accept[state] >= 0)
+                {
+                    accept = tables.Accept[state];
+                    matched = length;
+                }
+            }
+
+            if (matched == 0)
+            {
+                m_type = TokenType::__jam__;
+                m_text = m_view.substr(0, 1);
+                m_view.remove_prefix(1);
+                return;
+            }
+
+            const auto& action = tables.Actions[tables.RuleBase[lexerState]
+                                                + accept];
+            m_type = action.Token;
+            m_text = m_view.substr(0, matched);
+            m_view.remove_prefix(matched);
+            m_line += action.Increment;
+            m_state = action.Transition;
+        }
+    };
+}
@@ -0,0 +1,261 @@
+#include <cache/cache.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+#include <utils.hpp>
+
+constexpr char* cache_header = "plexiglass-dfa";
+constexpr int cache_version = 2;
+
+/// <summary>
+/// Get the key a lexer state's DFA is cached under. It's saved along with the
+/// DFA, so hash collisions and DFAs saved by other versions are caught.
+/// </summary>
+/// <param name="patterns">The lexer state's patterns, in order.</param>
+/// <returns>The key.</returns>
+std::string GetKey(const std::vector<std::string_view>& patterns)
+{
+    std::stringstream key;
+    key << cache_header << " " << cache_version << "\n";
+    for (const auto& pattern : patterns)
+    {
+        key << pattern.size() << ":" << pattern << "\n";
+    }
+    return key.str();
+}
+
+/// <summary>
+/// Write a DFA to a cache file.
+/// </summary>
+/// <param name="out">The cache file.</param>
+/// <param name="key">The key the DFA is cached under.</param>
+/// <param name="dfa">The DFA.</param>
+void WriteDfa(std::ostream& out,
+              const std::string& key,
+              const AutomatonCache::Dfa& dfa)
+{
+    out << key.size() << "\n"
+        << key << dfa.States << " " << dfa.Classes << " " << dfa.Start
+        << "\n";
+
+    for (size_t byte = 0; byte < 256; byte++)
+    {
+        out << static_cast<unsigned int>(dfa.ByteClass[byte]) << " ";
+    }
+    out << "\n";
+
+    for (const auto& next : dfa.Next)
+    {
+        out << next << " ";
+    }
+    out << "\n";
+
+    for (const auto& accept : dfa.Accept)
+    {
+        out << accept << " ";
+    }
+    out << "\n";
+}
+
+/// <summary>
+/// Read a DFA from a cache file, checking that it's whole and consistent.
+/// </summary>
+/// <param name="in">The cache file.</param>
+/// <param name="key">The key the DFA should be cached under.</param>
+/// <param name="patterns">How many patterns the DFA matches.</param>
+/// <param name="dfa">Set to the DFA.</param>
+/// <returns>Whether the file held the right DFA.</returns>
+bool ReadDfa(std::istream& in,
+             const std::string& key,
+             size_t patterns,
+             AutomatonCache::Dfa& dfa)
+{
+    size_t keySize = 0;
+    if (!(in >> keySize) || in.get() != '\n' || keySize != key.size())
+    {
+        return false;
+    }
+
+    std::string savedKey(keySize, '\0');
+    if (!in.read(savedKey.data(), keySize) || savedKey != key)
+    {
+        return false;
+    }
+
+    if (!(in >> dfa.States >> dfa.Classes >> dfa.Start) || dfa.States == 0
+        || dfa.States > plexiglass::max_states || dfa.Classes == 0
+        || dfa.Classes > 256 || dfa.Start >= dfa.States)
+    {
+        return false;
+    }
+
+    for (size_t byte = 0; byte < 256; byte++)
+    {
+        unsigned int byteClass = 0;
+        if (!(in >> byteClass) || byteClass >= dfa.Classes)
+        {
+            return false;
+        }
+        dfa.ByteClass[byte] = static_cast<uint8_t>(byteClass);
+    }
+
+    dfa.Next.clear();
+    for (size_t entry = 0; entry < dfa.States * dfa.Classes; entry++)
+    {
+        size_t next = 0;
+        if (!(in >> next) || next >= dfa.States)
+        {
+            return false;
+        }
+        dfa.Next.push_back(static_cast<uint16_t>(next));
+    }
+
+    dfa.Accept.clear();
+    for (size_t state = 0; state < dfa.States; state++)
+    {
+        int accept = 0;
+        if (!(in >> accept) || accept < -1
+            || accept >= static_cast<int>(patterns))
+        {
+            return false;
+        }
+        dfa.Accept.push_back(static_cast<int16_t>(accept));
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Construct an AutomatonCache.
+/// </summary>
+/// <param name="directory">
+/// Where to keep cached DFAs. If empty, nothing is read or saved.
+/// </param>
+AutomatonCache::AutomatonCache(std::filesystem::path directory)
+    : m_directory(directory)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+/// <summary>
+/// Retrieve where cached DFAs are kept.
+/// </summary>
+/// <returns>The cache directory.</returns>
+const std::filesystem::path& AutomatonCache::Directory() const
+{
+    return m_directory;
+}
+
+/// <summary>
+/// Retrieve how many DFAs were read from the cache.
+/// </summary>
+/// <returns>The number of DFAs read.</returns>
+size_t AutomatonCache::Hits() const
+{
+    return m_hits;
+}
+
+/// <summary>
+/// Retrieve how many DFAs had to be built.
+/// </summary>
+/// <returns>The number of DFAs built.</returns>
+size_t AutomatonCache::Misses() const
+{
+    return m_misses;
+}
+
+/// <summary>
+/// Find the DFA for a lexer state's patterns.
+/// </summary>
+/// <param name="patterns">The lexer state's patterns, in order.</param>
+/// <returns>The DFA, or nullptr if it isn't cached.</returns>
+const AutomatonCache::Dfa*
+AutomatonCache::Find(const std::vector<std::string_view>& patterns)
+{
+    std::string key = GetKey(patterns);
+
+    auto found = m_dfas.find(key);
+    if (found != m_dfas.end())
+    {
+        return found->second.get();
+    }
+
+    // Anything wrong with the file just means the DFA gets built again.
+    std::unique_ptr<Dfa> dfa;
+    if (!m_directory.empty())
+    {
+        std::ifstream in(GetPath(key), std::ios::binary);
+        dfa = std::make_unique<Dfa>();
+        if (in && ReadDfa(in, key, patterns.size(), *dfa))
+        {
+            m_hits++;
+        }
+        else
+        {
+            dfa.reset();
+        }
+    }
+
+    return (m_dfas[key] = std::move(dfa)).get();
+}
+
+/// <summary>
+/// Save the DFA built for a lexer state's patterns.
+/// </summary>
+/// <param name="patterns">The lexer state's patterns, in order.</param>
+/// <param name="dfa">The DFA.</param>
+void AutomatonCache::Store(const std::vector<std::string_view>& patterns,
+                           const Dfa& dfa)
+{
+    std::string key = GetKey(patterns);
+    m_misses++;
+    m_dfas[key] = std::make_unique<Dfa>(dfa);
+
+    if (m_directory.empty())
+    {
+        return;
+    }
+
+    // Failing to save only costs the next run some time, so errors are
+    // ignored. The DFA is written under a name no other run uses, then
+    // renamed, so concurrent runs never read half a file.
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+
+    std::filesystem::path path = GetPath(key);
+    std::filesystem::path temporary = path;
+    temporary += "." + std::to_string(std::random_device()()) + ".tmp";
+
+    bool written;
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        WriteDfa(out, key, dfa);
+        written = static_cast<bool>(out);
+    }
+
+    if (written)
+    {
+        std::filesystem::rename(temporary, path, error);
+    }
+    if (!written || error)
+    {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+/// <summary>
+/// Get the file a DFA is cached in.
+/// </summary>
+/// <param name="key">The key the DFA is cached under.</param>
+/// <returns>The file's path.</returns>
+std::filesystem::path AutomatonCache::GetPath(const std::string& key) const
+{
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << Hash(key)
+         << ".dfa";
+    return m_directory / name.str();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <automaton/automaton.hpp>
+
+/// <summary>
+/// Lexer states' compiled DFAs, saved on disk so later runs can skip
+/// building them. Each DFA is keyed by a hash of its lexer state's patterns,
+/// in order, so it's reused whenever those patterns come back, no matter
+/// what else about the lexer changed. Pass it to plexiglass::Build.
+/// </summary>
+class AutomatonCache
+{
+public:
+    using Automaton = plexiglass::Automaton<plexiglass::DynamicStorage>;
+    using Dfa = plexiglass::Dfa<plexiglass::DynamicStorage>;
+
+    AutomatonCache(std::filesystem::path directory);
+
+    /// <summary>
+    /// Find the DFA for a lexer state's patterns.
+    /// </summary>
+    /// <param name="automaton">The automaton being built.</param>
+    /// <param name="rules">The rules it's being built from.</param>
+    /// <param name="state">The lexer state.</param>
+    /// <returns>The DFA, or nullptr if it isn't cached.</returns>
+    template <typename Storage, typename Rules>
+    const Dfa* Find(const plexiglass::Automaton<Storage>& automaton,
+                    const Rules& rules,
+                    size_t state)
+    {
+        return Find(GetPatterns(automaton, rules, state));
+    }
+
+    /// <summary>
+    /// Save the DFA built for a lexer state's patterns.
+    /// </summary>
+    /// <param name="automaton">The automaton being built.</param>
+    /// <param name="rules">The rules it's being built from.</param>
+    /// <param name="state">The lexer state.</param>
+    /// <param name="dfa">The DFA.</param>
+    template <typename Storage, typename Rules>
+    void Store(const plexiglass::Automaton<Storage>& automaton,
+               const Rules& rules,
+               size_t state,
+               const Dfa& dfa)
+    {
+        Store(GetPatterns(automaton, rules, state), dfa);
+    }
+
+    const std::filesystem::path& Directory() const;
+    size_t Hits() const;
+    size_t Misses() const;
+
+private:
+    std::filesystem::path m_directory;
+    std::map<std::string, std::unique_ptr<Dfa>> m_dfas;
+    size_t m_hits;
+    size_t m_misses;
+
+    /// <summary>
+    /// Get a lexer state's patterns, in order.
+    /// </summary>
+    template <typename Storage, typename Rules>
+    static std::vector<std::string_view>
+    GetPatterns(const plexiglass::Automaton<Storage>& automaton,
+                const Rules& rules,
+                size_t state)
+    {
+        std::vector<std::string_view> patterns;
+        for (size_t rule = automaton.RuleBase[state];
+             rule < automaton.RuleBase[state + 1];
+             rule++)
+        {
+            patterns.push_back(rules[automaton.Rules[rule]].Pattern);
+        }
+        return patterns;
+    }
+
+    const Dfa* Find(const std::vector<std::string_view>& patterns);
+    void Store(const std::vector<std::string_view>& patterns, const Dfa& dfa);
+    std::filesystem::path GetPath(const std::string& key) const;
+};
@@ -91,6 +91,18 @@ void Error(size_t line, std::string message)
     throw PlexiException(out.str().c_str());
 }
 
+/// <summary>
+/// Generate an error message about a profile and stop generating.
+/// </summary>
+/// <param name="path">Path to the profile.</param>
+/// <param name="message">The message to display.</param>
+void ProfileError(std::string path, std::string message)
+{
+    std::stringstream out;
+    out << "Error in profile " << path << ": " << message;
+    throw PlexiException(out.str().c_str());
+}
+
 /// <summary>
 /// Generate an error message and stop parsing.
 /// </summary>
@@ -19,4 +19,5 @@ void MissingNameError(size_t line, std::string name);
 void UnreachableStateError(size_t line, std::string name);
 void MissingStateError(size_t line, std::string name);
 void Error(size_t line, std::string message);
+void ProfileError(std::string path, std::string message);
 void Error(std::string expected, size_t line, TokenType type, std::string text);
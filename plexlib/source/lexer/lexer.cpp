@@ -10,7 +10,7 @@ namespace expressions
     constexpr char* alternator = "\\|";
     constexpr char* comment = "#[^\n]*";
     constexpr char* full_action =
-        "produce-nothing|rewind|\\+\\+line|line\\+\\+|--line|line--";
+        "produce-nothing|rewind|intern|\\+\\+line|line\\+\\+|--line|line--";
     constexpr char* identifier = "[^\\|# \t\r\n]+";
     constexpr char* indent = "\t|    ";
     constexpr char* junk = "[^\\s][^\n]+";
@@ -19,7 +19,7 @@ namespace expressions
     constexpr char* keyword_rule = "rule";
     constexpr char* line = "[^\n]+";
     constexpr char* newline = "\n";
-    constexpr char* partial_action = "produce|state|transition";
+    constexpr char* partial_action = "produce|state|transition|convert";
     constexpr char* statement_end = "\n\n";
     constexpr char* whitespace = "[ \t]";
 }
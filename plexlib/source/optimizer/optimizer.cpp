@@ -0,0 +1,276 @@
+#include <optimizer/optimizer.hpp>
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
+
+constexpr char* initial_state = "__initial__";
+
+std::string GetActiveState(RuleNode rule);
+std::string GetTargetState(RuleNode rule);
+std::string GetSignature(RuleNode rule);
+void MergeEquivalentStates(FileNode file);
+void PruneUnreachableStates(FileNode file);
+
+/// <summary>
+/// Simplify a semantically valid lexer without changing what it matches.
+/// </summary>
+/// <param name="file">The lexer. Modified in place.</param>
+void Optimize(FileNode file)
+{
+    PruneUnreachableStates(file);
+    MergeEquivalentStates(file);
+}
+
+/// <summary>
+/// Get the state a rule is active in.
+/// </summary>
+/// <param name="rule">The rule.</param>
+/// <returns>The state the rule is active in.</returns>
+std::string GetActiveState(RuleNode rule)
+{
+    for (const auto& action : rule->actions)
+    {
+        if (action->name == "state")
+        {
+            return action->identifier;
+        }
+    }
+
+    return initial_state;
+}
+
+/// <summary>
+/// Get the state a rule leaves the lexer in.
+/// </summary>
+/// <param name="rule">The rule.</param>
+/// <returns>The state the rule transitions to.</returns>
+std::string GetTargetState(RuleNode rule)
+{
+    for (const auto& action : rule->actions)
+    {
+        if (action->name == "transition")
+        {
+            return action->identifier;
+        }
+    }
+
+    return GetActiveState(rule);
+}
+
+/// <summary>
+/// Get a string describing what a rule does, excluding which state it's
+/// active in and which state it transitions to. Rules with the same
+/// signature behave the same way.
+/// </summary>
+/// <param name="rule">The rule.</param>
+/// <returns>The rule's signature.</returns>
+std::string GetSignature(RuleNode rule)
+{
+    std::vector<std::string> actions;
+
+    for (const auto& action : rule->actions)
+    {
+        std::string name = action->name;
+
+        if (name == "state" || name == "transition"
+            || name == "produce-nothing")
+        {
+            continue;
+        }
+        else if (name == "++line")
+        {
+            name = "line++";
+        }
+        else if (name == "--line")
+        {
+            name = "line--";
+        }
+
+        actions.push_back(name + ' ' + action->identifier);
+    }
+
+    std::sort(actions.begin(), actions.end());
+
+    std::string signature = rule->name;
+    for (const auto& action : actions)
+    {
+        signature += '\n' + action;
+    }
+
+    return signature;
+}
+
+/// <summary>
+/// Get the states reachable from the initial state by following
+/// transitions.
+/// </summary>
+/// <param name="file">The lexer.</param>
+/// <returns>Names of all reachable states.</returns>
+std::set<std::string> GetReachableStates(FileNode file)
+{
+    std::map<std::string, std::set<std::string>> targets;
+
+    for (const auto& rule : file->rules)
+    {
+        targets[GetActiveState(rule)].insert(GetTargetState(rule));
+    }
+
+    std::set<std::string> reachable = { initial_state };
+    std::queue<std::string> pending;
+    pending.push(initial_state);
+
+    while (!pending.empty())
+    {
+        std::string state = pending.front();
+        pending.pop();
+
+        for (const auto& target : targets[state])
+        {
+            if (reachable.insert(target).second)
+            {
+                pending.push(target);
+            }
+        }
+    }
+
+    return reachable;
+}
+
+/// <summary>
+/// Remove rules for states the lexer can never enter. The tokens they produce
+/// are kept in the file's pruned tokens, so every TokenType the lexer
+/// describes is still generated.
+/// </summary>
+/// <param name="file">The lexer. Modified in place.</param>
+void PruneUnreachableStates(FileNode file)
+{
+    std::set<std::string> reachable = GetReachableStates(file);
+    auto& rules = file->rules;
+
+    auto isReachable = [&reachable](const RuleNode& rule) {
+        return reachable.count(GetActiveState(rule)) > 0;
+    };
+
+    auto pruned =
+        std::stable_partition(rules.begin(), rules.end(), isReachable);
+
+    for (auto rule = pruned; rule != rules.end(); rule++)
+    {
+        for (const auto& action : (*rule)->actions)
+        {
+            if (action->name == "produce")
+            {
+                file->prunedTokens.insert(action->identifier);
+            }
+        }
+    }
+
+    rules.erase(pruned, rules.end());
+}
+
+/// <summary>
+/// Merge states that have identical rules into a single state.
+/// </summary>
+/// <param name="file">The lexer. Modified in place.</param>
+void MergeEquivalentStates(FileNode file)
+{
+    std::vector<std::string> states = { initial_state };
+    std::map<std::string, std::vector<RuleNode>> stateRules;
+    stateRules[initial_state];
+
+    for (const auto& rule : file->rules)
+    {
+        std::string active = GetActiveState(rule);
+        if (stateRules.count(active) == 0)
+        {
+            states.push_back(active);
+        }
+        stateRules[active].push_back(rule);
+    }
+
+    // Start by treating states whose rules match the same things in the same
+    // order as equivalent, then keep splitting classes apart until every
+    // member of a class also transitions into the same classes. Classes are
+    // only ever split, so an unchanged class count means nothing changed.
+    std::map<std::string, size_t> classes;
+    size_t classCount = 0;
+
+    while (true)
+    {
+        std::map<std::vector<std::string>, size_t> keys;
+        std::map<std::string, size_t> refined;
+
+        for (const auto& state : states)
+        {
+            std::vector<std::string> key;
+
+            if (!classes.empty())
+            {
+                key.push_back(std::to_string(classes[state]));
+            }
+
+            for (const auto& rule : stateRules[state])
+            {
+                key.push_back(GetSignature(rule));
+
+                if (!classes.empty())
+                {
+                    std::string target = GetTargetState(rule);
+                    if (classes.count(target) > 0)
+                    {
+                        key.push_back(std::to_string(classes[target]));
+                    }
+                    else
+                    {
+                        key.push_back('=' + target); // e.g. __jail__
+                    }
+                }
+            }
+
+            refined[state] = keys.emplace(key, keys.size()).first->second;
+        }
+
+        bool stable = !classes.empty() && keys.size() == classCount;
+        classes = refined;
+        classCount = keys.size();
+
+        if (stable)
+        {
+            break;
+        }
+    }
+
+    // The first state seen in each class represents it. __initial__ is seen
+    // first, so it always represents its own class.
+    std::map<size_t, std::string> representatives;
+    for (const auto& state : states)
+    {
+        representatives.emplace(classes[state], state);
+    }
+
+    std::vector<RuleNode> merged;
+    for (const auto& rule : file->rules)
+    {
+        std::string active = GetActiveState(rule);
+        if (representatives[classes[active]] != active)
+        {
+            continue; // Duplicates the representative's rules.
+        }
+
+        for (auto& action : rule->actions)
+        {
+            if ((action->name == "state" || action->name == "transition")
+                && classes.count(action->identifier) > 0)
+            {
+                action->identifier =
+                    representatives[classes[action->identifier]];
+            }
+        }
+
+        merged.push_back(rule);
+    }
+
+    file->rules = merged;
+}
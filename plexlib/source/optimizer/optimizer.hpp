@@ -0,0 +1,9 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+#include <parser/tree.hpp>
+
+void Optimize(FileNode file);
+std::set<std::string> GetReachableStates(FileNode file);
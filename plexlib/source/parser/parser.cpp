@@ -37,10 +37,12 @@ FileNode Parse(std::filesystem::path path)
 ActionNode Action(Lexer& lexer)
 {
     static std::set<std::string> unitActions = { "produce-nothing", "rewind",
-                                                 "++line",          "line++",
-                                                 "--line",          "line--" };
+                                                 "intern",          "++line",
+                                                 "line++",          "--line",
+                                                 "line--" };
     static std::set<std::string> compositeActions = { "produce", "state",
-                                                      "transition" };
+                                                      "transition",
+                                                      "convert" };
 
     Require(lexer, "indent", TokenType::Indent);
     size_t line = lexer.PeekLine();
@@ -46,6 +46,15 @@ std::ostream& operator<<(std::ostream& out, const FileNode& node)
         out << rule;
     }
 
+    if (!node->prunedTokens.empty())
+    {
+        out << "\tPruned tokens:\n";
+        for (auto& token : node->prunedTokens)
+        {
+            out << "\t\t" << token << "\n";
+        }
+    }
+
     return out;
 }
 
@@ -39,6 +39,7 @@ struct _FileNode
     std::vector<ExpressionNode> expressions;
     std::vector<PatternNode> patterns;
     std::vector<RuleNode> rules;
+    std::set<std::string> prunedTokens; // produced by rules that were pruned
 };
 
 struct _ExpressionNode
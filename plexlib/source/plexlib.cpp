@@ -5,6 +5,7 @@
 
 #include <analyzer/analyzer.hpp>
 #include <error.hpp>
+#include <optimizer/optimizer.hpp>
 #include <parser/parser.hpp>
 #include <parser/tree.hpp>
 #include <templater/templater.hpp>
@@ -17,9 +18,33 @@
 void PrintUsage(std::ostream& out)
 {
     out << "Usage:\n"
-        << "    plexiglass [--debug] filename\n"
+        << "    plexiglass [--debug] [--automaton] [--mmap] [--coroutine] "
+           "[--count-lines]\n"
+        << "               [--lookahead=tokens] [--parallel] [--incremental]\n"
+        << "               [--profile-use=profile] "
+           "[--cache-dir=directory]\n"
+        << "               [--verbose] filename\n"
         << "\n"
         << "  --debug: Generate a lexer with a debug driver.\n"
+        << "  --automaton: Match with a compiled automaton instead of "
+           "std::regex.\n"
+        << "  --mmap: Map input files into memory instead of reading them.\n"
+        << "  --coroutine: Generate a C++20 coroutine that yields tokens.\n"
+        << "  --count-lines: Count lines by newlines instead of line "
+           "actions.\n"
+        << "  --lookahead: How many tokens past the next one the lexer can "
+           "peek at.\n"
+        << "  --parallel: Add LexParallel(), which lexes an input on several "
+           "threads.\n"
+        << "  --incremental: Add Relex(), which lexes an input again after "
+           "it's edited.\n"
+        << "                 Needs --automaton.\n"
+        << "  --profile-use: Lay the lexer out using a profile saved by its "
+           "debug driver.\n"
+        << "  --cache-dir: Cache compiled automata in a directory. They "
+           "aren't cached\n"
+        << "               otherwise.\n"
+        << "  --verbose: Report what was generated and how the cache did.\n"
         << "\n"
         << "  filename: Name of the input file.\n"
         << "\n"
@@ -60,19 +85,29 @@ bool IsValidLexerName(const std::string& name)
 /// <param name="args">Arguments to parse.</param>
 /// <param name="path">Initialized to the lexer file's path.</param>
 /// <param name="help">Initialized to whether help was requested.</param>
-/// <param name="debug">
-/// Initialized to whether debug mode was requested.
+/// <param name="verbose">
+/// Initialized to whether a report was requested.
+/// </param>
+/// <param name="options">
+/// Initialized to how the lexer was requested to be generated.
 /// </param>
 /// <returns>Whether the command line arguments were valid.</returns>
 bool ParseArgs(const std::vector<std::string>& args,
                std::string& path,
                bool& help,
-               bool& debug)
+               bool& verbose,
+               TemplateOptions& options)
 {
+    const std::string profileFlag = "--profile-use=";
+    const std::string cacheFlag = "--cache-dir=";
+    const std::string lookaheadFlag = "--lookahead=";
+
     path = "";
     help = false;
-    debug = false;
+    verbose = false;
+    options = TemplateOptions();
     bool good = true;
+    bool lookahead = false;
 
     for (const auto& arg : args)
     {
@@ -86,11 +121,99 @@ bool ParseArgs(const std::vector<std::string>& args,
         }
         else if (arg == "-d" || arg == "--debug")
         {
-            if (debug)
+            if (options.Debug)
+            {
+                good = false;
+            }
+            options.Debug = true;
+        }
+        else if (arg == "-a" || arg == "--automaton")
+        {
+            if (options.Automaton)
+            {
+                good = false;
+            }
+            options.Automaton = true;
+        }
+        else if (arg == "--mmap")
+        {
+            if (options.Mmap)
+            {
+                good = false;
+            }
+            options.Mmap = true;
+        }
+        else if (arg == "--coroutine")
+        {
+            if (options.Coroutine)
+            {
+                good = false;
+            }
+            options.Coroutine = true;
+        }
+        else if (arg == "--count-lines")
+        {
+            if (options.CountLines)
+            {
+                good = false;
+            }
+            options.CountLines = true;
+        }
+        else if (arg.compare(0, lookaheadFlag.size(), lookaheadFlag) == 0)
+        {
+            // Each token of lookahead is a slot in the lexer, so a handful is
+            // plenty.
+            std::string count = arg.substr(lookaheadFlag.size());
+            if (lookahead || count.empty() || count.size() > 3
+                || count.find_first_not_of("0123456789") != std::string::npos)
+            {
+                good = false;
+            }
+            else
+            {
+                options.Lookahead = std::stoul(count);
+            }
+            lookahead = true;
+        }
+        else if (arg == "--incremental")
+        {
+            if (options.Incremental)
+            {
+                good = false;
+            }
+            options.Incremental = true;
+        }
+        else if (arg == "--parallel")
+        {
+            if (options.Parallel)
             {
                 good = false;
             }
-            debug = true;
+            options.Parallel = true;
+        }
+        else if (arg.compare(0, profileFlag.size(), profileFlag) == 0)
+        {
+            if (!options.Profile.empty() || arg.size() == profileFlag.size())
+            {
+                good = false;
+            }
+            options.Profile = arg.substr(profileFlag.size());
+        }
+        else if (arg.compare(0, cacheFlag.size(), cacheFlag) == 0)
+        {
+            if (!options.Cache.empty() || arg.size() == cacheFlag.size())
+            {
+                good = false;
+            }
+            options.Cache = arg.substr(cacheFlag.size());
+        }
+        else if (arg == "-v" || arg == "--verbose")
+        {
+            if (verbose)
+            {
+                good = false;
+            }
+            verbose = true;
         }
         else
         {
@@ -102,6 +225,12 @@ bool ParseArgs(const std::vector<std::string>& args,
         }
     }
 
+    // Only the automaton knows how far past each token it read.
+    if (options.Incremental && !options.Automaton)
+    {
+        good = false;
+    }
+
     return good;
 }
 
@@ -117,9 +246,10 @@ int PlexMain(std::vector<std::string>& args,
              std::ostream& err)
 {
     std::string lexerPath;
-    bool help, debug;
+    bool help, verbose;
+    TemplateOptions options;
 
-    bool good = ParseArgs(args, lexerPath, help, debug);
+    bool good = ParseArgs(args, lexerPath, help, verbose, options);
 
     if (!good)
     {
@@ -157,7 +287,21 @@ int PlexMain(std::vector<std::string>& args,
     {
         FileNode file = Parse(source);
         Analyze(file);
-        Template(file, lexerName, header, code, debug);
+        Optimize(file);
+        TemplateReport report =
+            Template(file, lexerName, header, code, options);
+
+        if (verbose)
+        {
+            out << "Generated " << header.string() << " and "
+                << code.string() << "\n";
+            if (options.Automaton && !options.Cache.empty())
+            {
+                out << "Automaton cache " << options.Cache.string() << ": "
+                    << report.CacheHits << " hits, " << report.CacheMisses
+                    << " misses\n";
+            }
+        }
         return success;
     }
     catch (const PlexiException& exc)
@@ -0,0 +1,53 @@
+#include <profile/profile.hpp>
+
+#include <sstream>
+
+#include <error.hpp>
+#include <utils.hpp>
+
+constexpr char* profile_header = "plexiglass-profile";
+
+/// <summary>
+/// Read a profile written by a debug lexer's driver.
+///
+/// The first line is "plexiglass-profile" followed by the lexer's key. Each
+/// remaining line is "rule" or "state", an index, and a count.
+/// </summary>
+/// <param name="path">Path to the profile.</param>
+/// <returns>The profile.</returns>
+Profile ReadProfile(std::filesystem::path path)
+{
+    std::stringstream in(ReadFile(path));
+    Profile profile;
+    std::string header;
+
+    if (!(in >> header >> profile.Key) || header != profile_header)
+    {
+        ProfileError(path.string(), "Not a Plexiglass profile");
+    }
+
+    std::string kind;
+    size_t index, count;
+    while (in >> kind >> index >> count)
+    {
+        if (kind == "rule")
+        {
+            profile.RuleHits[index] += count;
+        }
+        else if (kind == "state")
+        {
+            profile.StateHits[index] += count;
+        }
+        else
+        {
+            ProfileError(path.string(), "Unknown entry '" + kind + "'");
+        }
+    }
+
+    if (!in.eof())
+    {
+        ProfileError(path.string(), "Malformed entry");
+    }
+
+    return profile;
+}
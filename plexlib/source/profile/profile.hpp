@@ -0,0 +1,18 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+
+/// <summary>
+/// Counts recorded by a debug lexer's driver, used to lay out lexers for the
+/// input they're run on.
+/// </summary>
+struct Profile
+{
+    std::string Key;                    // fingerprint of the profiled lexer
+    std::map<size_t, size_t> RuleHits;  // times each rule matched
+    std::map<size_t, size_t> StateHits; // times each state was entered
+};
+
+Profile ReadProfile(std::filesystem::path path);
@@ -1,12 +1,20 @@
 #include <templater/templater.hpp>
 
 #include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <numeric>
 #include <set>
 #include <sstream>
 
+#include <automaton/automaton.hpp>
+#include <cache/cache.hpp>
+#include <error.hpp>
+#include <profile/profile.hpp>
 #include <template-holder.hpp>
 #include <utils.hpp>
 
@@ -24,16 +32,20 @@ struct TemplateRule
     std::string Transition; // state this rule transitions to
     std::string Token;      // what gets produced (if anything)
     int Increment;          // how much to increment the line number by
+    bool Rewind;            // whether the matched text is lexed again
+    bool Intern;            // whether the matched text is interned
+    std::string Convert;    // what the matched text is converted to
 };
 
 /// <summary>
-/// Get names defined by a lexer.
+/// Get names defined by a lexer, including those only its pruned rules
+/// produced.
 /// </summary>
 /// <param name="node">The lexer.</param>
 /// <param name="names">Populated with defined names.</param>
 void GetTokenNames(FileNode node, std::set<std::string>& names)
 {
-    names.clear();
+    names = node->prunedTokens;
 
     for (const auto& rule : node->rules)
     {
@@ -74,6 +86,20 @@ void GetRule(ActionNode node, TemplateRule& rule)
     {
         rule.Increment = -1;
     }
+    else if (node->name == "rewind")
+    {
+        rule.Rewind = true;
+    }
+    else if (node->name == "intern")
+    {
+        rule.Intern = true;
+    }
+    else if (node->name == "convert")
+    {
+        // Conversion's enumerators are the conversions, capitalized.
+        rule.Convert = node->identifier;
+        rule.Convert[0] = static_cast<char>(std::toupper(rule.Convert[0]));
+    }
     else if (node->name == "transition")
     {
         rule.Transition = node->identifier;
@@ -95,7 +121,7 @@ void GetRule(ActionNode node, TemplateRule& rule)
 /// <returns>TemplateRule for the RuleNode.</returns>
 TemplateRule GetRule(RuleNode node)
 {
-    TemplateRule rule = { "", node->name, "", "", 0 };
+    TemplateRule rule = { "", node->name, "", "", 0, false, false, "None" };
 
     for (const auto& action : node->actions)
     {
@@ -106,23 +132,18 @@ TemplateRule GetRule(RuleNode node)
 }
 
 /// <summary>
-/// Get the string to be substituted into the template's rule location.
+/// Get TemplateRules for every rule in a lexer, with defaults filled in.
 /// </summary>
 /// <param name="node">The lexer.</param>
-/// <returns>The rule string.</returns>
-std::string GetRuleString(FileNode node)
+/// <returns>The lexer's rules, in order.</returns>
+std::vector<TemplateRule> GetTemplateRules(FileNode node)
 {
     std::vector<TemplateRule> producedRules;
 
     for (auto& rule : node->rules)
     {
         TemplateRule producedRule = GetRule(rule);
-        producedRules.push_back(producedRule);
-    }
 
-    std::stringstream out;
-    for (auto& producedRule : producedRules)
-    {
         if (producedRule.Token == "")
         {
             producedRule.Token = nothing_token;
@@ -135,24 +156,75 @@ std::string GetRuleString(FileNode node)
         {
             producedRule.Transition = producedRule.Active;
         }
-        out << "\n    __rules__.emplace_back(LexerState::"
+
+        producedRules.push_back(producedRule);
+    }
+
+    return producedRules;
+}
+
+/// <summary>
+/// Sort indices by how many times a profile saw them, most first. Indices seen
+/// equally often keep their order.
+/// </summary>
+/// <param name="begin">Start of the indices to sort.</param>
+/// <param name="end">End of the indices to sort.</param>
+/// <param name="hits">How many times the profile saw each index.</param>
+void SortByHits(std::vector<size_t>::iterator begin,
+                std::vector<size_t>::iterator end,
+                const std::map<size_t, size_t>& hits)
+{
+    auto count = [&hits](size_t index) {
+        auto hit = hits.find(index);
+        return hit == hits.end() ? 0 : hit->second;
+    };
+
+    std::stable_sort(begin, end, [&count](size_t left, size_t right) {
+        return count(left) > count(right);
+    });
+}
+
+/// <summary>
+/// Get the string to be substituted into the template's rule location.
+/// </summary>
+/// <param name="node">The lexer.</param>
+/// <param name="profile">
+/// How often each rule matched. Rules that matched more come first.
+/// </param>
+/// <returns>The rule string.</returns>
+std::string GetRuleString(FileNode node, const Profile& profile)
+{
+    std::vector<TemplateRule> rules = GetTemplateRules(node);
+    std::vector<size_t> order(rules.size());
+    std::iota(order.begin(), order.end(), 0);
+    SortByHits(order.begin(), order.end(), profile.RuleHits);
+
+    std::stringstream out;
+    for (size_t index : order)
+    {
+        const TemplateRule& producedRule = rules[index];
+        out << "\n        { LexerState::"
             << producedRule.Active << ", " << producedRule.Pattern
             << ", LexerState::" << producedRule.Transition
             << ", TokenType::" << producedRule.Token << ", "
-            << producedRule.Increment << ");";
+            << producedRule.Increment << ", "
+            << (producedRule.Rewind ? "true" : "false") << ", "
+            << (producedRule.Intern ? "true" : "false")
+            << ", Conversion::" << producedRule.Convert << ", " << index
+            << " },";
     }
 
     std::string outStr = out.str();
-    outStr.erase(0, 5); // Erase leading "\n    "
+    outStr.erase(0, 9); // Erase leading "\n        "
     return outStr;
 }
 
 /// <summary>
-/// Replace $LEXER_STATES
+/// Get the names of a lexer's states, in the order LexerState declares them.
 /// </summary>
-/// <param name="content">String to replace in.</param>
-/// <param name="lexer">Lexer with state names.</param>
-void ReplaceLexerStates(std::string& content, const FileNode lexer)
+/// <param name="lexer">The lexer.</param>
+/// <returns>The state names.</returns>
+std::vector<std::string> GetLexerStates(const FileNode lexer)
 {
     std::set<std::string> states;
 
@@ -167,17 +239,93 @@ void ReplaceLexerStates(std::string& content, const FileNode lexer)
         }
     }
 
+    std::vector<std::string> names = { initial_state };
+    names.insert(names.end(), states.begin(), states.end());
+    names.push_back(jail_state);
+    return names;
+}
+
+/// <summary>
+/// Check whether any of a lexer's rules converts the text it matches.
+/// </summary>
+/// <param name="file">The lexer.</param>
+/// <returns>Whether the lexer converts numbers.</returns>
+bool ConvertsNumbers(FileNode file)
+{
+    for (const auto& rule : GetTemplateRules(file))
+    {
+        if (rule.Convert != "None")
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// <summary>
+/// Get the key that identifies a lexer's profiles. It changes whenever the
+/// lexer's rules do, so a stale profile can't be applied to the wrong rules.
+/// </summary>
+/// <param name="file">The lexer.</param>
+/// <returns>The key.</returns>
+std::string GetProfileKey(FileNode file)
+{
+    std::map<std::string, std::string> expressions;
+    for (const auto& expression : file->expressions)
+    {
+        expressions[expression->name] = expression->expression;
+    }
+
+    std::stringstream content;
+    for (const auto& state : GetLexerStates(file))
+    {
+        content << state << "\n";
+    }
+    for (const auto& rule : GetTemplateRules(file))
+    {
+        content << rule.Active << "\n"
+                << expressions[rule.Pattern] << "\n"
+                << rule.Transition << "\n"
+                << rule.Token << "\n"
+                << rule.Increment << "\n";
+        if (rule.Rewind)
+        {
+            content << "rewind\n";
+        }
+        if (rule.Intern)
+        {
+            content << "intern\n";
+        }
+        if (rule.Convert != "None")
+        {
+            content << "convert " << rule.Convert << "\n";
+        }
+    }
+
+    std::stringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0')
+        << Hash(content.str());
+    return key.str();
+}
+
+/// <summary>
+/// Replace $LEXER_STATES
+/// </summary>
+/// <param name="content">String to replace in.</param>
+/// <param name="lexer">Lexer with state names.</param>
+void ReplaceLexerStates(std::string& content, const FileNode lexer)
+{
     std::stringstream names;
-    names << initial_state << ",\n    ";
 
-    for (const auto& state : states)
+    for (const auto& state : GetLexerStates(lexer))
     {
         names << state << ",\n    ";
     }
 
-    names << jail_state << ",";
+    std::string namesStr = names.str();
+    namesStr.erase(namesStr.size() - 5, 5); // Erase the trailing "\n    "
 
-    Replace(content, "$LEXER_STATES", names.str());
+    Replace(content, "$LEXER_STATES", namesStr);
 }
 
 /// <summary>
@@ -235,10 +383,272 @@ void ReplaceExpressions(std::string& content, FileNode lexer)
 /// </summary>
 /// <param name="content">String to replace in.</param>
 /// <param name="file">The lexer to generate rules from.</param>
-void ReplaceRules(std::string& content, FileNode file)
+/// <param name="profile">How often each rule matched.</param>
+void ReplaceRules(std::string& content,
+                  FileNode file,
+                  const Profile& profile)
 {
-    std::string ruleString = GetRuleString(file);
+    std::string ruleString = GetRuleString(file, profile);
     Replace(content, "$LEXER_RULES", ruleString);
+    Replace(content, "$RULE_COUNT", std::to_string(file->rules.size()));
+}
+
+/// <summary>
+/// A rule as the automaton builder sees it.
+/// </summary>
+struct AutomatonRule
+{
+    size_t Active;            // index of the state this rule is active in
+    std::string_view Pattern; // regex to match
+};
+
+/// <summary>
+/// Format numbers as a comma-separated list, wrapping lines as needed.
+/// </summary>
+/// <param name="values">The numbers.</param>
+/// <param name="perLine">How many numbers to put on each line.</param>
+/// <returns>The formatted list.</returns>
+template <typename T>
+std::string FormatNumbers(const std::vector<T>& values, size_t perLine)
+{
+    std::stringstream out;
+
+    for (size_t index = 0; index < values.size(); index++)
+    {
+        if (index > 0)
+        {
+            out << (index % perLine == 0 ? ",\n    " : ", ");
+        }
+        out << values[index];
+    }
+    out << ",";
+
+    return out.str();
+}
+
+/// <summary>
+/// Compile a lexer's rules into an automaton.
+/// </summary>
+/// <param name="file">The lexer.</param>
+/// <param name="cache">Where to look for automata before building them.</param>
+/// <returns>The automaton.</returns>
+plexiglass::Automaton<plexiglass::DynamicStorage>
+BuildAutomaton(FileNode file, AutomatonCache& cache)
+{
+    std::vector<TemplateRule> rules = GetTemplateRules(file);
+    std::vector<std::string> states = GetLexerStates(file);
+
+    std::map<std::string, ExpressionNode> expressions;
+    for (const auto& expression : file->expressions)
+    {
+        expressions[expression->name] = expression;
+    }
+
+    std::vector<AutomatonRule> automatonRules;
+    for (const auto& rule : rules)
+    {
+        size_t active = std::find(states.begin(), states.end(), rule.Active)
+                        - states.begin();
+        automatonRules.push_back(
+            { active, expressions[rule.Pattern]->expression });
+    }
+
+    auto automaton = plexiglass::Build<plexiglass::DynamicStorage>(
+        automatonRules, states.size(), cache);
+
+    if (automaton.Result != plexiglass::Status::Success)
+    {
+        ExpressionNode expression =
+            expressions[rules[automaton.ErrorRule].Pattern];
+
+        std::stringstream message;
+        message << "Expression '" << expression->name << "' ";
+        switch (automaton.Result)
+        {
+        case plexiglass::Status::Malformed:
+            message << "isn't a valid regular expression";
+            break;
+        case plexiglass::Status::Unsupported:
+            message << "uses a feature automata can't express, like anchors "
+                       "or backreferences";
+            break;
+        default:
+            message << "makes the automaton too large";
+            break;
+        }
+        message << " (at offset " << automaton.ErrorOffset << ")";
+
+        Error(expression->line, message.str());
+    }
+
+    return automaton;
+}
+
+/// <summary>
+/// Renumber an automaton's states by how often a profile entered them, so the
+/// hot states' code and transitions sit together and the cold ones trail
+/// behind. The dead state stays first.
+/// </summary>
+/// <param name="automaton">The automaton.</param>
+/// <param name="profile">How often each state was entered.</param>
+/// <returns>The number each state had before, by its new number.</returns>
+std::vector<size_t>
+ReorderStates(plexiglass::Automaton<plexiglass::DynamicStorage>& automaton,
+              const Profile& profile)
+{
+    std::vector<size_t> order(automaton.States);
+    std::iota(order.begin(), order.end(), 0);
+    SortByHits(order.begin() + 1, order.end(), profile.StateHits);
+
+    std::vector<uint16_t> position(automaton.States);
+    for (size_t state = 0; state < automaton.States; state++)
+    {
+        position[order[state]] = static_cast<uint16_t>(state);
+    }
+
+    auto next = automaton.Next;
+    auto accept = automaton.Accept;
+    for (size_t state = 0; state < automaton.States; state++)
+    {
+        for (size_t byteClass = 0; byteClass < automaton.Classes; byteClass++)
+        {
+            automaton.Next[state * automaton.Classes + byteClass] =
+                position[next[order[state] * automaton.Classes + byteClass]];
+        }
+        automaton.Accept[state] = accept[order[state]];
+    }
+    for (auto& start : automaton.Start)
+    {
+        start = position[start];
+    }
+
+    return order;
+}
+
+/// <summary>
+/// Get the code for each state of an automaton.
+/// </summary>
+/// <param name="automaton">The automaton.</param>
+/// <param name="order">
+/// The number each state had before being reordered. Profiles count visits
+/// by those numbers.
+/// </param>
+/// <returns>The code for every state.</returns>
+std::string GetStateBlocks(
+    const plexiglass::Automaton<plexiglass::DynamicStorage>& automaton,
+    const std::vector<size_t>& order)
+{
+    std::stringstream out;
+
+    for (size_t state = 0; state < automaton.States; state++)
+    {
+        size_t row = state * automaton.Classes;
+        bool dead = std::all_of(automaton.Next.begin() + row,
+                                automaton.Next.begin() + row
+                                    + automaton.Classes,
+                                [](uint16_t next) { return next == 0; });
+
+        out << "\nstate_" << state << ":\n"
+            << "    PLEXIGLASS_VISIT(" << order[state] << ");\n";
+
+        if (automaton.Accept[state] >= 0)
+        {
+            out << "    accept = " << automaton.Accept[state] << ";\n"
+                << "    matched = length;\n";
+        }
+
+        if (dead)
+        {
+            out << "    goto done;\n";
+            continue;
+        }
+
+        out << "    if (length == size)\n"
+            << "    {\n"
+            << "        goto end;\n"
+            << "    }\n"
+            << "    state = transitions[" << row
+            << " + byte_classes[data[length++]]];\n"
+            << "    PLEXIGLASS_DISPATCH();\n";
+    }
+
+    std::string outStr = out.str();
+    outStr.erase(0, 1);                  // Erase the leading "\n"
+    outStr.erase(outStr.size() - 1, 1); // Erase the trailing "\n"
+    return outStr;
+}
+
+/// <summary>
+/// Replace the automaton's tables and state code.
+/// </summary>
+/// <param name="content">String to replace in.</param>
+/// <param name="file">The lexer to generate the automaton from.</param>
+/// <param name="profile">How often each state was entered.</param>
+/// <param name="cache">Where to look for automata before building them.</param>
+void ReplaceAutomaton(std::string& content,
+                      FileNode file,
+                      const Profile& profile,
+                      AutomatonCache& cache)
+{
+    auto automaton = BuildAutomaton(file, cache);
+    std::vector<size_t> order = ReorderStates(automaton, profile);
+    std::vector<TemplateRule> rules = GetTemplateRules(file);
+    std::vector<std::string> states = GetLexerStates(file);
+
+    std::vector<unsigned int> byteClasses(std::begin(automaton.ByteClass),
+                                          std::end(automaton.ByteClass));
+
+    std::stringstream transitions;
+    for (size_t state = 0; state < automaton.States; state++)
+    {
+        auto row = automaton.Next.begin() + state * automaton.Classes;
+        std::vector<uint16_t> next(row, row + automaton.Classes);
+        transitions << (state > 0 ? "\n    " : "") << FormatNumbers(next, 16);
+    }
+
+    std::stringstream starts, bases;
+    for (size_t state = 0; state < states.size(); state++)
+    {
+        starts << (state > 0 ? "\n    " : "") << automaton.Start[state]
+               << ", // " << states[state];
+        bases << (state > 0 ? "\n    " : "") << automaton.RuleBase[state]
+              << ", // " << states[state];
+    }
+
+    std::stringstream actions;
+    for (size_t index = 0; index < automaton.Rules.size(); index++)
+    {
+        const TemplateRule& rule = rules[automaton.Rules[index]];
+        actions << (index > 0 ? "\n    " : "") << "{ LexerState::"
+                << rule.Transition << ", TokenType::" << rule.Token << ", "
+                << rule.Increment << ", "
+                << (rule.Rewind ? "true" : "false") << ", "
+                << (rule.Intern ? "true" : "false") << ", Conversion::"
+                << rule.Convert << " },";
+    }
+
+    std::stringstream labels, cases;
+    for (size_t state = 0; state < automaton.States; state++)
+    {
+        labels << (state == 0 ? "" : state % 5 == 0 ? ",\n        " : ", ")
+               << "&&state_" << state;
+        cases << (state > 0 ? "\n    " : "") << "case " << state
+              << ":\n        goto state_" << state << ";";
+    }
+    labels << ",";
+
+    Replace(content, "$CLASS_COUNT", std::to_string(automaton.Classes));
+    Replace(content, "$BYTE_CLASSES", FormatNumbers(byteClasses, 16));
+    Replace(content, "$TRANSITIONS", transitions.str());
+    Replace(content, "$START_STATES", starts.str());
+    Replace(content, "$RULE_BASES", bases.str());
+    Replace(content, "$ACTIONS", actions.str());
+    Replace(content, "$ACTION_RULES", FormatNumbers(automaton.Rules, 16));
+    Replace(content, "$STATE_LABELS", labels.str());
+    Replace(content, "$STATE_CASES", cases.str());
+    Replace(content, "$STATE_BLOCKS", GetStateBlocks(automaton, order));
+    Replace(content, "$STATE_COUNT", std::to_string(automaton.States));
+    Replace(content, "$RULE_COUNT", std::to_string(rules.size()));
 }
 
 /// <summary>
@@ -283,12 +693,108 @@ void SaveFile(const std::string& content, const std::filesystem::path& path)
 /// <param name="file">The lexer to generate from.</param>
 /// <param name="header">Path to the output header.</param>
 /// <param name="name">Name of the lexer.</param>
+/// <param name="options">How to generate the lexer.</param>
 void TemplateHeader(FileNode file,
                     std::filesystem::path header,
-                    std::string name)
+                    std::string name,
+                    const TemplateOptions& options)
 {
     std::string content = header_template;
 
+    Replace(content,
+            "$MAPPED_INPUT",
+            options.Mmap ? "\n    std::shared_ptr<const char> m_mapping;"
+                           " // input file, if mapped"
+                         : "");
+    Replace(content,
+            "$ENGINE_INCLUDE",
+            options.Automaton ? "" : "\n#include <regex>");
+    Replace(content,
+            "$SCAN_TYPE",
+            options.Automaton
+                ? "\n\n"
+                  "    // Where the automaton stopped when fed input ran out.\n"
+                  "    struct ScanState\n"
+                  "    {\n"
+                  "        size_t State = 0;\n"
+                  "        size_t Length = 0;\n"
+                  "        size_t Matched = 0;\n"
+                  "        size_t Accept = 0;\n"
+                  "    };"
+                : "");
+    Replace(content,
+            "$CHECKPOINT_STATE",
+            options.Automaton
+                ? "\n        ScanState Scan;"
+                  + std::string(options.Incremental ? "\n        size_t Reach;"
+                                                    : "")
+                : "");
+    Replace(content,
+            "$ENGINE_STATE",
+            options.Automaton
+                ? "\n\n"
+                  "    ScanState m_scan;"
+                  + std::string(options.Incremental
+                                    ? "\n    size_t m_reach = 0; // how far "
+                                      "lexing has read, for Relex()"
+                                    : "")
+                : "\n\n"
+                  "    // The rules' compiled patterns, looked up once per "
+                  "lexer rather than\n"
+                  "    // once per token.\n"
+                  "    static const std::vector<std::regex>& Patterns();\n"
+                  "    const std::vector<std::regex>* m_patterns = "
+                  "&Patterns();");
+    Replace(content,
+            "$PARALLEL",
+            options.Parallel
+                ? "\n\n"
+                  "    // Every token in an input, in arrays like "
+                  "TokenBatch's.\n"
+                  "    struct TokenArrays\n"
+                  "    {\n"
+                  "        std::vector<TokenType> Types;\n"
+                  "        std::vector<size_t> Offsets;\n"
+                  "        std::vector<size_t> Lengths;\n"
+                  "        std::vector<size_t> Lines;\n"
+                  "        std::vector<size_t> Columns;\n"
+                  "    };\n"
+                  "\n"
+                  "    static TokenArrays LexParallel(std::string_view input,\n"
+                  "                                   size_t threads = 0,\n"
+                  "                                   "
+                  "bool everyState = false);"
+                : "");
+    Replace(content,
+            "$RELEX",
+            options.Incremental
+                ? "\n\n"
+                  "    // Every token in an input, and what Relex() needs to "
+                  "lex them again.\n"
+                  "    struct TokenStream\n"
+                  "    {\n"
+                  "        std::vector<Lexed> Tokens;\n"
+                  "        std::vector<LexerState> States; // after each "
+                  "token\n"
+                  "        std::vector<size_t> Reaches;    // how far each "
+                  "token read\n"
+                  "        SymbolTable Symbols;            // what Tokens "
+                  "interned\n"
+                  "    };\n"
+                  "\n"
+                  "    static TokenStream LexStream(std::string_view input);\n"
+                  "    static void Relex(TokenStream& stream,\n"
+                  "                      std::string_view input,\n"
+                  "                      size_t offset,\n"
+                  "                      size_t removed,\n"
+                  "                      size_t inserted);"
+                : "");
+    Replace(content,
+            "$COROUTINE",
+            options.Coroutine ? coroutine_template : "");
+    Replace(content, "$LOOKAHEAD", std::to_string(options.Lookahead));
+    Replace(content, "$EOF_TOKEN", eof_token);
+    Replace(content, "$NOTHING_TOKEN", nothing_token);
     Replace(content, "$LEXER_NAME", name);
     ReplaceTokens(content, file);
 
@@ -301,23 +807,56 @@ void TemplateHeader(FileNode file,
 /// <param name="file">The lexer to generate from.</param>
 /// <param name="code">Path to the output code file.</param>
 /// <param name="name">Name of the lexer.</param>
-/// <param name="debug">Whether to generate a debug mode lexer.</param>
+/// <param name="options">How to generate the lexer.</param>
+/// <param name="profile">The profile to lay the lexer out with.</param>
+/// <param name="cache">Where to look for automata before building them.</param>
 void TemplateBody(FileNode file,
                   std::filesystem::path code,
                   std::string name,
-                  bool debug)
+                  const TemplateOptions& options,
+                  const Profile& profile,
+                  AutomatonCache& cache)
 {
-    std::string content = code_template;
+    // The template comes in parts to keep each literal small enough for MSVC
+    std::string content;
+    for (const char* part : code_template)
+    {
+        content += part;
+    }
 
+    Replace(content,
+            "$ENGINE",
+            options.Automaton ? automaton_template : regex_template);
+    Replace(content, "$PARALLEL", options.Parallel ? parallel_template : "");
+    Replace(content, "$RELEX", options.Incremental ? relex_template : "");
+    // Converting needs floating-point std::from_chars, which older standard
+    // libraries lack, so it's only emitted for lexers that use it.
+    bool converts = ConvertsNumbers(file);
+    Replace(content, "$CONVERSION", converts ? convert_template : "");
+    Replace(content,
+            "$FILE_INPUT",
+            options.Mmap ? mmap_template : read_template);
     Replace(content, "$EOF_TOKEN", eof_token);
     Replace(content, "$INVALID_TOKEN", jam_token);
     Replace(content, "$NOTHING_TOKEN", nothing_token);
     Replace(content, "$LEXER_NAME", name);
     ReplaceLexerStates(content, file);
-    ReplaceExpressions(content, file);
-    ReplaceRules(content, file);
+    if (options.Automaton)
+    {
+        ReplaceAutomaton(content, file, profile, cache);
+    }
+    else
+    {
+        ReplaceExpressions(content, file);
+        ReplaceRules(content, file, profile);
+    }
     ReplaceToString(content, file);
-    Replace(content, "$DEBUG_MODE", (debug ? "1" : "0"));
+    Replace(content, "$PROFILE_KEY", profile.Key);
+    Replace(content, "$COUNT_LINES", (options.CountLines ? "1" : "0"));
+    Replace(content, "$AUTOMATON", (options.Automaton ? "1" : "0"));
+    Replace(content, "$INCREMENTAL", (options.Incremental ? "1" : "0"));
+    Replace(content, "$DEBUG_MODE", (options.Debug ? "1" : "0"));
+    Replace(content, "$CONVERT_NUMBERS", (converts ? "1" : "0"));
     SaveFile(content, code);
 }
 
@@ -328,15 +867,38 @@ void TemplateBody(FileNode file,
 /// <param name="name">Name of the lexer.</param>
 /// <param name="header">Path to the output header.</param>
 /// <param name="code">Path to the output code file.</param>
-/// <param name="debug">Whether to generate a debug mode lexer.</param>
-void Template(FileNode file,
-              std::string name,
-              std::filesystem::path header,
-              std::filesystem::path code,
-              bool debug)
+/// <param name="options">How to generate the lexer.</param>
+/// <returns>What happened while generating the lexer.</returns>
+TemplateReport Template(FileNode file,
+                        std::string name,
+                        std::filesystem::path header,
+                        std::filesystem::path code,
+                        const TemplateOptions& options)
 {
+    // Without a profile, an empty one leaves everything in its usual order.
+    Profile profile;
+    std::string key = GetProfileKey(file);
+
+    if (!options.Profile.empty())
+    {
+        profile = ReadProfile(options.Profile);
+        if (profile.Key != key)
+        {
+            ProfileError(options.Profile.string(),
+                         "Recorded from a different lexer");
+        }
+    }
+    profile.Key = key;
+
+    AutomatonCache cache(options.Cache);
+
     std::filesystem::remove(header);
     std::filesystem::remove(code);
-    TemplateHeader(file, header, name);
-    TemplateBody(file, code, name, debug);
+    TemplateHeader(file, header, name, options);
+    TemplateBody(file, code, name, options, profile, cache);
+
+    TemplateReport report;
+    report.CacheHits = cache.Hits();
+    report.CacheMisses = cache.Misses();
+    return report;
 }
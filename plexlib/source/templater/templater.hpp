@@ -5,8 +5,28 @@
 
 #include <parser/tree.hpp>
 
-void Template(FileNode file,
-              std::string name,
-              std::filesystem::path header,
-              std::filesystem::path code,
-              bool debug);
+struct TemplateOptions
+{
+    bool Debug = false;            // generate a debug driver
+    bool Automaton = false;        // match with a compiled automaton
+    bool Mmap = false;             // map input files instead of reading them
+    bool Coroutine = false;        // generate a coroutine yielding tokens
+    bool CountLines = false;       // count newlines instead of line actions
+    size_t Lookahead = 0;          // how far past the next token to peek
+    bool Parallel = false;         // lex whole inputs on several threads
+    bool Incremental = false;      // lex edited inputs again (automaton only)
+    std::filesystem::path Profile; // profile to lay the lexer out with
+    std::filesystem::path Cache;   // where to cache automata, if anywhere
+};
+
+struct TemplateReport
+{
+    size_t CacheHits = 0;   // automata read from the cache
+    size_t CacheMisses = 0; // automata that had to be built
+};
+
+TemplateReport Template(FileNode file,
+                        std::string name,
+                        std::filesystem::path header,
+                        std::filesystem::path code,
+                        const TemplateOptions& options);
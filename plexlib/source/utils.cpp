@@ -46,3 +46,22 @@ void Replace(std::string& subject,
                                        // like replacing 'x' with 'yx'
     }
 }
+
+/// <summary>
+/// Hash a string with 64-bit FNV-1a. Unlike std::hash, the result is the
+/// same on every platform, so it can be saved to files.
+/// </summary>
+/// <param name="content">The string to hash.</param>
+/// <returns>The hash.</returns>
+uint64_t Hash(const std::string& content)
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for (const auto& c : content)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
 
 std::string ReadFile(std::filesystem::path path);
 void Replace(std::string& subject,
              const std::string& find,
-             const std::string& replace);
\ No newline at end of file
+             const std::string& replace);
+uint64_t Hash(const std::string& content);
@@ -0,0 +1,212 @@
+#include <cstdint>
+
+// The lexer's rules, compiled into a deterministic finite automaton. State 0
+// is dead: once the automaton reaches it, no longer match is possible. Every
+// table is constant, so lexers on different threads can share them freely.
+constexpr size_t class_count = $CLASS_COUNT;
+
+// Bytes that every rule treats the same way share a class.
+constexpr uint8_t byte_classes[256] = {
+    $BYTE_CLASSES
+};
+
+// transitions[state * class_count + class] is where a byte in class leads.
+constexpr uint16_t transitions[] = {
+    $TRANSITIONS
+};
+
+// Where each LexerState's automaton starts.
+constexpr uint16_t start_states[] = {
+    $START_STATES
+};
+
+struct Action
+{
+    LexerState Transition; // state the rule transitions to
+    TokenType Token;       // what gets produced
+    int Increment;         // how much to change the line number by
+    bool Rewind;           // whether the matched text is lexed again
+    bool Intern;           // whether the matched text is interned
+    Conversion Convert;    // what the matched text is converted to
+};
+
+// What each rule does, grouped by the state it's active in. Automaton states
+// accept rules by their index within the group.
+constexpr size_t rule_bases[] = {
+    $RULE_BASES
+};
+
+constexpr Action actions[] = {
+    $ACTIONS
+};
+
+#if $DEBUG_MODE
+// The index in the lexer description of the rule behind each action.
+constexpr size_t action_rules[] = {
+    $ACTION_RULES
+};
+
+// How many times each rule matched on this thread, by its index in the lexer
+// description.
+thread_local size_t rule_hits[$RULE_COUNT] = {};
+
+// How many times each automaton state was entered on this thread, by the
+// number it had before the states were laid out.
+thread_local size_t state_visits[$STATE_COUNT] = {};
+
+/// <summary>
+/// Write how many times each rule matched and each state was entered to a
+/// profile.
+/// </summary>
+/// <param name="out">The profile.</param>
+void WriteProfile(std::ostream& out)
+{
+    for (size_t rule = 0; rule < $RULE_COUNT; rule++)
+    {
+        out << "rule " << rule << " " << rule_hits[rule] << "\n";
+    }
+    for (size_t state = 0; state < $STATE_COUNT; state++)
+    {
+        out << "state " << state << " " << state_visits[state] << "\n";
+    }
+}
+
+#define PLEXIGLASS_VISIT(state) state_visits[state]++
+#else
+#define PLEXIGLASS_VISIT(state)
+#endif
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // Computed gotos
+#endif
+
+/// <summary>
+/// Helper function for $LEXER_NAME::Shift().
+/// </summary>
+/// <returns>
+/// Whether a token was found. If not, more input has to be fed first.
+/// </returns>
+bool $LEXER_NAME::ShiftHelper()
+{
+    if (m_view.empty())
+    {
+        if (m_more)
+        {
+            return false;
+        }
+
+        m_type = TokenType::$EOF_TOKEN;
+        m_length = 0;
+#if $INCREMENTAL
+        m_reach = m_offset + 1;
+#endif
+        return true;
+    }
+
+    const unsigned char* data =
+        reinterpret_cast<const unsigned char*>(m_view.data());
+    size_t size = m_view.size();
+    size_t length = m_scan.Length;
+    size_t matched = m_scan.Matched;
+    size_t accept = m_scan.Accept;
+    size_t state = start_states[static_cast<size_t>(m_state)];
+
+    // Every automaton state has its own block of code. GCC and Clang jump
+    // between blocks through a table of label addresses, so each state ends
+    // in its own indirect branch, which the branch predictor can learn
+    // separately. Other compilers go through one shared switch instead.
+#if defined(__GNUC__)
+    static const void* const labels[] = {
+        $STATE_LABELS
+    };
+#define PLEXIGLASS_DISPATCH() goto* labels[state]
+#else
+#define PLEXIGLASS_DISPATCH() goto dispatch
+#endif
+
+    // If fed input ran out partway through this token, the automaton picks
+    // up where it stopped rather than starting over. The state it stopped in
+    // was already entered, so it goes straight on to that state's next byte.
+    if (length > 0)
+    {
+        state = m_scan.State;
+        if (length == size)
+        {
+            goto end;
+        }
+
+        size_t byte = data[length++];
+        state = transitions[state * class_count + byte_classes[byte]];
+    }
+
+    PLEXIGLASS_DISPATCH();
+
+$STATE_BLOCKS
+
+#if !defined(__GNUC__)
+dispatch:
+    switch (state)
+    {
+    $STATE_CASES
+    }
+#endif
+#undef PLEXIGLASS_DISPATCH
+#undef PLEXIGLASS_VISIT
+
+end:
+    if (m_more)
+    {
+        if (length > m_maxTokenLength)
+        {
+            throw std::exception("$LEXER_NAME::Shift(): Token longer than "
+                                 "the maximum token length.");
+        }
+
+        m_scan = { state, length, matched, accept };
+        return false;
+    }
+
+#if $INCREMENTAL
+    // The automaton wanted more input, so what it matched depends on there
+    // being none.
+    length++;
+#endif
+
+done:
+    m_scan = {};
+#if $INCREMENTAL
+    m_reach = m_offset + length > m_reach ? m_offset + length : m_reach;
+#endif
+    if (matched > 0)
+    {
+        size_t index = rule_bases[static_cast<size_t>(m_state)] + accept;
+        const Action& action = actions[index];
+#if $DEBUG_MODE
+        rule_hits[action_rules[index]]++;
+#endif
+
+        // A rule that rewinds leaves its text to be lexed again.
+        m_type = action.Token;
+        m_length = action.Rewind ? 0 : matched;
+        m_intern = action.Intern;
+        m_convert = action.Convert;
+        m_view.remove_prefix(m_length);
+#if !$COUNT_LINES
+        m_line += action.Increment;
+#endif
+        m_state = action.Transition;
+        return true;
+    }
+    else
+    {
+        m_type = TokenType::$INVALID_TOKEN;
+        m_length = 1;
+        m_view.remove_prefix(1);
+        return true;
+    }
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,69 @@
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/// <summary>
+/// Convert a number's text to its value, without allocating or looking at the
+/// locale. Numbers too big to represent are clamped to the largest there is,
+/// and floats too small become 0, as strtoll() and strtod() do. Anything after
+/// the number, like a suffix, is ignored.
+/// </summary>
+/// <param name="text">The number's text.</param>
+/// <param name="convert">How to read it.</param>
+/// <param name="integer">Set to its value, unless it's a float.</param>
+/// <param name="real">Set to its value as a float.</param>
+void ConvertNumber(std::string_view text,
+                   Conversion convert,
+                   int64_t& integer,
+                   double& real)
+{
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    bool negative = first != last && *first == '-';
+
+    if (convert == Conversion::Float)
+    {
+        std::from_chars_result result = std::from_chars(first, last, real);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            const char* exponent = std::find_if(first, last, [](char c) {
+                return c == 'e' || c == 'E';
+            });
+            bool tiny = exponent != last && exponent + 1 != last
+                        && exponent[1] == '-';
+            real = tiny ? 0 : HUGE_VAL;
+            real = negative ? -real : real;
+        }
+    }
+    else if (convert == Conversion::Hex)
+    {
+        // Hex numbers are read as 64 unsigned bits, so any bit pattern fits.
+        if (last - first > 2 && first[0] == '0'
+            && (first[1] == 'x' || first[1] == 'X'))
+        {
+            first += 2;
+        }
+
+        uint64_t bits = 0;
+        std::from_chars_result result = std::from_chars(first, last, bits, 16);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            bits = std::numeric_limits<uint64_t>::max();
+        }
+        integer = static_cast<int64_t>(bits);
+        real = static_cast<double>(bits);
+    }
+    else
+    {
+        std::from_chars_result result = std::from_chars(first, last, integer);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            integer = negative ? std::numeric_limits<int64_t>::min()
+                               : std::numeric_limits<int64_t>::max();
+        }
+        real = static_cast<double>(integer);
+    }
+}
@@ -0,0 +1,196 @@
+
+#include <coroutine>
+#include <exception>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+/// <summary>
+/// A coroutine that yields a lexer's tokens one at a time, up to but not
+/// including $EOF_TOKEN. Its frame is allocated from the memory resource the
+/// coroutine is called with.
+/// </summary>
+class TokenGenerator
+{
+public:
+    struct promise_type
+    {
+        Token Current{};
+
+        TokenGenerator get_return_object()
+        {
+            return TokenGenerator(
+                std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always yield_value(Token token) noexcept
+        {
+            Current = token;
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception()
+        {
+            throw;
+        }
+
+        // The frame is followed by the memory resource it came from, so it
+        // can be given back to it.
+        static void* operator new(size_t size,
+                                  $LEXER_NAME&,
+                                  std::pmr::memory_resource& memory)
+        {
+            void* frame = memory.allocate(Padded(size), alignment);
+            new (Resource(frame, size)) std::pmr::memory_resource*(&memory);
+            return frame;
+        }
+
+        static void operator delete(void* frame, size_t size)
+        {
+            std::pmr::memory_resource* memory = *Resource(frame, size);
+            memory->deallocate(frame, Padded(size), alignment);
+        }
+
+    private:
+        static constexpr size_t alignment = alignof(std::max_align_t);
+        static constexpr size_t pointer = sizeof(std::pmr::memory_resource*);
+
+        static size_t Padded(size_t size)
+        {
+            return (size + pointer - 1) / pointer * pointer + pointer;
+        }
+
+        static std::pmr::memory_resource** Resource(void* frame, size_t size)
+        {
+            return std::launder(reinterpret_cast<std::pmr::memory_resource**>(
+                static_cast<char*>(frame) + Padded(size) - pointer));
+        }
+    };
+
+    /// <summary>
+    /// Resumes the coroutine to get each token in turn.
+    /// </summary>
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Token;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        explicit iterator(std::coroutine_handle<promise_type> handle)
+            : m_handle(handle)
+        {
+        }
+
+        Token operator*() const
+        {
+            return m_handle.promise().Current;
+        }
+
+        iterator& operator++()
+        {
+            m_handle.resume();
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            m_handle.resume();
+        }
+
+        bool operator==(std::default_sentinel_t) const
+        {
+            return !m_handle || m_handle.done();
+        }
+
+    private:
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    explicit TokenGenerator(std::coroutine_handle<promise_type> handle)
+        : m_handle(handle)
+    {
+    }
+
+    TokenGenerator(TokenGenerator&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr))
+    {
+    }
+
+    TokenGenerator& operator=(TokenGenerator&& other) noexcept
+    {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+
+    ~TokenGenerator()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    /// <summary>
+    /// Start the coroutine. Its tokens can only be iterated over once.
+    /// </summary>
+    /// <returns>An iterator at the first token.</returns>
+    iterator begin()
+    {
+        m_handle.resume();
+        return iterator(m_handle);
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return {};
+    }
+
+private:
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/// <summary>
+/// Yield the lexer's tokens as they're lexed. A lexer being fed input yields
+/// $NOTHING_TOKEN when it runs out; feed it more, or finish its input, before
+/// resuming.
+/// </summary>
+/// <param name="lex">The lexer.</param>
+/// <param name="memory">
+/// Where to allocate the coroutine's frame from. Only promise_type's operator
+/// new uses it.
+/// </param>
+/// <returns>The coroutine.</returns>
+inline TokenGenerator Tokens(
+    $LEXER_NAME& lex,
+    [[maybe_unused]] std::pmr::memory_resource& memory =
+        *std::pmr::new_delete_resource())
+{
+    // A lexer being fed input starts out waiting to lex its first token.
+    if (lex.PeekToken() == TokenType::$NOTHING_TOKEN)
+    {
+        lex.Shift();
+    }
+
+    while (lex.PeekToken() != TokenType::$EOF_TOKEN)
+    {
+        co_yield Token{ lex.PeekToken(), lex.PeekText(), lex.PeekLine() };
+        lex.Shift();
+    }
+}
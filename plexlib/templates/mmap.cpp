@@ -0,0 +1,127 @@
+// Included last, so the platform's macros can't clash with token names.
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// Map a file into memory, read-only, for reading from start to end.
+/// </summary>
+/// <param name="path">Path to the file to map.</param>
+/// <param name="size">Set to the file's size.</param>
+/// <returns>
+/// The mapping, or nullptr if the file can't be mapped. Pipes, special files,
+/// and empty files can't be.
+/// </returns>
+std::shared_ptr<const char> MapFile(const std::filesystem::path& path,
+                                    size_t& size)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize)
+        || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping =
+        CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+    {
+        return nullptr;
+    }
+
+    // The view keeps the mapping open on its own.
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr)
+    {
+        return nullptr;
+    }
+
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return std::shared_ptr<const char>(
+        static_cast<const char*>(view),
+        [](const char* data) { UnmapViewOfFile(data); });
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0)
+    {
+        close(file);
+        return nullptr;
+    }
+
+    // The mapping stays valid after the file is closed.
+    size_t length = static_cast<size_t>(info.st_size);
+    void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    posix_madvise(view, length, POSIX_MADV_SEQUENTIAL);
+
+    size = length;
+    return std::shared_ptr<const char>(
+        static_cast<const char*>(view),
+        [length](const char* data) {
+            munmap(const_cast<char*>(data), length);
+        });
+#endif
+}
+
+/// <summary>
+/// Construct $LEXER_NAME to lex a file. The file is mapped into memory
+/// rather than read when possible, and tokens' text points into the mapping.
+/// </summary>
+/// <param name="path">Path to the file to lex.</param>
+$LEXER_NAME::$LEXER_NAME(const std::filesystem::path& path)
+    : m_state(LexerState::__initial__)
+    , m_line(1)
+{
+    size_t size = 0;
+    m_mapping = MapFile(path, size);
+
+    if (m_mapping)
+    {
+        m_view = std::string_view(m_mapping.get(), size);
+    }
+    else
+    {
+        m_reference = ReadFile(path);
+        m_view = m_reference;
+    }
+
+    Shift();
+}
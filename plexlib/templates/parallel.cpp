@@ -0,0 +1,361 @@
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Lex a whole input on several threads at once. The input is split into a
+/// chunk per thread, and each chunk is lexed on its own thread from a guess at
+/// the state it starts in. Where the guess was wrong, the lexer before it
+/// keeps going until it's back in step with one of the chunk's guesses, so
+/// only the text in between is lexed twice.
+///
+/// Normally chunks start just after newlines and are guessed to start in
+/// __initial__, which suits formats where most lines do. Otherwise chunks
+/// start anywhere and are lexed from every state, and guesses that catch up
+/// with each other stop there.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+/// <param name="threads">
+/// How many threads to lex on, or 0 for one per processor.
+/// </param>
+/// <param name="everyState">
+/// Whether to split chunks anywhere and lex them from every state.
+/// </param>
+/// <returns>The input's tokens, ending with $EOF_TOKEN.</returns>
+$LEXER_NAME::TokenArrays $LEXER_NAME::LexParallel(std::string_view input,
+                                                  size_t threads,
+                                                  bool everyState)
+{
+    if (threads == 0)
+    {
+        threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    // A guess at how to lex a chunk: its tokens, and the state its lexer was
+    // in before the first one and after each one. Lexers at the same place in
+    // the same state lex the same tokens from then on.
+    struct Run
+    {
+        size_t Start;
+        size_t LineStart; // where the line Start is on starts
+        std::unique_ptr<$LEXER_NAME> Lexer; // lexes from Start to the end
+        std::vector<Lexed> Tokens;
+        std::vector<LexerState> States;
+        std::exception_ptr Error;
+
+        // The guess this one caught up with, if any, and after how many of its
+        // tokens. This one stops there.
+        Run* Merge = nullptr;
+        size_t MergeAt = 0;
+
+        // Where the lexer was after the given number of tokens.
+        size_t Cursor(size_t tokens) const
+        {
+            return tokens == 0 ? Start
+                               : Tokens[tokens - 1].Offset
+                                     + Tokens[tokens - 1].Length;
+        }
+
+        // The line the lexer was on after the given number of tokens.
+        size_t Line(size_t tokens) const
+        {
+            return tokens == 0 ? 1 : Tokens[tokens - 1].Line;
+        }
+    };
+
+    struct Chunk
+    {
+        size_t Start;
+        size_t End;
+        std::vector<Run> Runs;
+    };
+
+    constexpr size_t states = static_cast<size_t>(LexerState::__jail__) + 1;
+
+    std::vector<Chunk> chunks;
+    for (size_t start = 0; start < input.size();)
+    {
+        size_t end = input.size();
+        if (chunks.size() + 1 < threads)
+        {
+            size_t split = input.size() / threads * (chunks.size() + 1);
+            if (everyState)
+            {
+                end = std::min(std::max(split, start + 1), end);
+            }
+            else
+            {
+                size_t newline = input.find('\n', std::max(start, split));
+                end = newline == std::string_view::npos ? end : newline + 1;
+            }
+        }
+
+        chunks.push_back({ start, end, {} });
+        start = end;
+    }
+
+    if (chunks.empty())
+    {
+        chunks.push_back({ 0, 0, {} });
+    }
+
+    for (auto& chunk : chunks)
+    {
+        chunk.Runs.resize(everyState && chunk.Start > 0 ? states : 1);
+        for (auto& run : chunk.Runs)
+        {
+            run.Start = chunk.Start;
+        }
+    }
+
+    // Take a lexer's next token and move it on to the one after. A lexer that
+    // failed before can only fail again, since it would be lexing the same
+    // text in the same state.
+    auto record = [](Run& run) {
+        if (run.Error)
+        {
+            std::rethrow_exception(run.Error);
+        }
+
+        $LEXER_NAME& lex = *run.Lexer;
+        Lexed token = lex.m_tokens[lex.m_first];
+        token.Offset += run.Start;
+        run.Tokens.push_back(token);
+        run.States.push_back(lex.m_state);
+        lex.Shift();
+    };
+
+    // Look through a guess for where it was at the given place, moving sync on
+    // to there. Returns whether it was there in the given state.
+    auto find = [](const Run& run,
+                   size_t& sync,
+                   size_t cursor,
+                   LexerState state) {
+        while (sync < run.States.size() && run.Cursor(sync) < cursor)
+        {
+            sync++;
+        }
+
+        return sync < run.States.size() && run.Cursor(sync) == cursor
+               && run.States[sync] == state;
+    };
+
+    auto lex = [input, &chunks, &record, &find](size_t index) {
+        Chunk& chunk = chunks[index];
+
+        // Find the newline before the chunk, if it's in the chunk before.
+        // Otherwise it's the same as the chunk before's.
+        size_t newline = std::string_view::npos;
+        if (index > 0)
+        {
+            size_t from = chunks[index - 1].Start;
+            newline = input.substr(from, chunk.Start - from).rfind('\n');
+            newline += newline == std::string_view::npos ? 0 : from + 1;
+        }
+        chunk.Runs[0].LineStart = index == 0 ? 0 : newline;
+
+        for (size_t state = 0; state < chunk.Runs.size(); state++)
+        {
+            // A guess that failed might only have failed because it was
+            // wrong, so its error can wait until it's needed.
+            Run& run = chunk.Runs[state];
+            try
+            {
+                // make_unique can't reach the private text constructor.
+                run.Lexer.reset(
+                    new $LEXER_NAME(TextInput(), input.substr(run.Start)));
+                if (state > 0)
+                {
+                    Checkpoint start{};
+                    start.State = static_cast<LexerState>(state);
+                    start.Line = 1;
+                    run.Lexer->Restore(start);
+                    run.Lexer->Shift();
+                }
+                run.States.push_back(static_cast<LexerState>(state));
+
+                std::vector<size_t> syncs(state, 0);
+                while (!run.Merge && run.Cursor(run.Tokens.size()) < chunk.End
+                       && run.Lexer->PeekToken() != TokenType::$EOF_TOKEN)
+                {
+                    record(run);
+                    size_t cursor = run.Cursor(run.Tokens.size());
+                    for (size_t other = 0; other < state; other++)
+                    {
+                        Run& earlier = chunk.Runs[other];
+                        if (find(earlier, syncs[other], cursor,
+                                 run.States.back()))
+                        {
+                            run.Merge = &earlier;
+                            run.MergeAt = syncs[other];
+                            break;
+                        }
+                    }
+                }
+            }
+            catch (...)
+            {
+                run.Error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t chunk = 1; chunk < chunks.size(); chunk++)
+    {
+        workers.emplace_back(lex, chunk);
+    }
+    lex(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    // The first chunk really did start in __initial__.
+    if (chunks[0].Runs[0].Error)
+    {
+        std::rethrow_exception(chunks[0].Runs[0].Error);
+    }
+
+    for (size_t index = 0; index < chunks.size(); index++)
+    {
+        size_t& lineStart = chunks[index].Runs[0].LineStart;
+        if (lineStart == std::string_view::npos)
+        {
+            lineStart = chunks[index - 1].Runs[0].LineStart;
+        }
+
+        for (auto& run : chunks[index].Runs)
+        {
+            run.LineStart = lineStart;
+        }
+    }
+
+    // Which of each guess's tokens are right, and how far off its line
+    // numbers are. Lines are shifted with unsigned arithmetic, which wraps
+    // around correctly when the shift is backwards.
+    struct Piece
+    {
+        Run* Source;
+        size_t First;
+        size_t Shift;
+    };
+
+    Run* owner = &chunks[0].Runs[0];
+    std::vector<Piece> pieces = { { owner, 0, 0 } };
+
+    // Carry on from where another guess was after the given number of tokens,
+    // since it's caught up with the owner.
+    auto follow = [&owner, &pieces](Run* run, size_t sync) {
+        size_t at = owner->Tokens.size();
+        size_t shift = pieces.back().Shift + owner->Line(at) - run->Line(sync);
+        owner = run;
+        pieces.push_back({ owner, sync, shift });
+    };
+
+    for (size_t index = 1; index < chunks.size(); index++)
+    {
+        std::vector<Run>& runs = chunks[index].Runs;
+        std::vector<size_t> syncs(runs.size(), 0);
+
+        while (true)
+        {
+            if (owner->Merge)
+            {
+                follow(owner->Merge, owner->MergeAt);
+                continue;
+            }
+
+            size_t at = owner->Tokens.size();
+            size_t cursor = owner->Cursor(at);
+            bool passed = true;
+            Run* match = nullptr;
+            for (size_t run = 0; run < runs.size() && !match; run++)
+            {
+                if (find(runs[run], syncs[run], cursor, owner->States[at]))
+                {
+                    match = &runs[run];
+                    follow(match, syncs[run]);
+                }
+                passed = passed && syncs[run] == runs[run].States.size();
+            }
+
+            // Either a guess at this chunk was right, or the lexer before it
+            // has gone past all of them.
+            if (match || passed
+                || owner->Lexer->PeekToken() == TokenType::$EOF_TOKEN)
+            {
+                break;
+            }
+
+            record(*owner);
+        }
+    }
+
+    while (true)
+    {
+        if (owner->Merge)
+        {
+            follow(owner->Merge, owner->MergeAt);
+            continue;
+        }
+
+        bool eof = owner->Lexer->PeekToken() == TokenType::$EOF_TOKEN;
+        record(*owner);
+        if (eof)
+        {
+            break;
+        }
+    }
+
+    // Copy the pieces into place, each on its own thread.
+    std::vector<size_t> starts = { 0 };
+    for (const auto& piece : pieces)
+    {
+        starts.push_back(starts.back() + piece.Source->Tokens.size()
+                         - piece.First);
+    }
+
+    TokenArrays tokens;
+    tokens.Types.resize(starts.back());
+    tokens.Offsets.resize(starts.back());
+    tokens.Lengths.resize(starts.back());
+    tokens.Lines.resize(starts.back());
+    tokens.Columns.resize(starts.back());
+
+    auto copy = [&tokens, &pieces, &starts](size_t index) {
+        const Run& run = *pieces[index].Source;
+        size_t out = starts[index];
+        for (size_t in = pieces[index].First; in < run.Tokens.size(); in++)
+        {
+            const Lexed& token = run.Tokens[in];
+            tokens.Types[out] = token.Type;
+            tokens.Offsets[out] = token.Offset;
+            tokens.Lengths[out] = token.Length;
+            tokens.Lines[out] = token.Line + pieces[index].Shift;
+
+            // Before its first newline, a guess counts columns from Start.
+            // Afterwards, its columns are always smaller than that.
+            tokens.Columns[out] = token.Column == token.Offset - run.Start + 1
+                                      ? token.Offset - run.LineStart + 1
+                                      : token.Column;
+            out++;
+        }
+    };
+
+    workers.clear();
+    for (size_t piece = 1; piece < pieces.size(); piece++)
+    {
+        workers.emplace_back(copy, piece);
+    }
+    copy(0);
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    return tokens;
+}
@@ -0,0 +1,8 @@
+/// <summary>
+/// Construct $LEXER_NAME to lex a file.
+/// </summary>
+/// <param name="path">Path to the file to lex.</param>
+$LEXER_NAME::$LEXER_NAME(const std::filesystem::path& path)
+    : $LEXER_NAME(TextInput(), ReadFile(path))
+{
+}
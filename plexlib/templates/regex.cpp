@@ -0,0 +1,179 @@
+#include <array>
+#include <regex>
+#include <vector>
+
+// The tables below are shared by every lexer and never change once the
+// program has started. All a lexer changes while it lexes lives in the lexer
+// object itself, so any number of lexers may run on separate threads at once.
+
+struct Rule
+{
+    LexerState Active;     // the state the rule is active in
+    const char* Pattern;   // a regular expression describing what it matches
+    LexerState Transition; // the state the rule transitions to
+    TokenType Token;       // the TokenType produced
+    int Increment;         // how much to change the current line number by
+    bool Rewind;           // whether the matched text is lexed again
+    bool Intern;           // whether the matched text is interned
+    Conversion Convert;    // what the matched text is converted to
+    size_t Priority;       // index in the lexer description; lower wins ties
+};
+
+/// <summary>
+/// Get the rules to be used by the lexer.
+/// </summary>
+/// <returns>The rules to be used by the lexer.</returns>
+constexpr std::array<Rule, $RULE_COUNT> GetRules()
+{
+    $EXPRESSIONS
+
+    return { {
+        $LEXER_RULES
+    } };
+}
+
+// The rules, built while compiling so no lexer has to build them first.
+constexpr std::array<Rule, $RULE_COUNT> rules = GetRules();
+
+/// <summary>
+/// Compile the rules' patterns.
+/// </summary>
+/// <returns>The compiled patterns, in the same order as the rules.</returns>
+std::vector<std::regex> CompilePatterns()
+{
+    std::vector<std::regex> patterns;
+    patterns.reserve(rules.size());
+    for (const Rule& rule : rules)
+    {
+        patterns.emplace_back(rule.Pattern);
+    }
+    return patterns;
+}
+
+/// <summary>
+/// Get the rules' compiled patterns. A std::regex can't be built while
+/// compiling, so they're compiled the first time a lexer is constructed, which
+/// the function-local static makes thread-safe. They're only read after that,
+/// and matching with a const std::regex is safe from any number of threads.
+/// </summary>
+/// <returns>The compiled patterns, in the same order as the rules.</returns>
+const std::vector<std::regex>& $LEXER_NAME::Patterns()
+{
+    static const std::vector<std::regex> patterns = CompilePatterns();
+    return patterns;
+}
+
+#if $DEBUG_MODE
+// How many times each rule matched on this thread, by its index in the lexer
+// description.
+thread_local size_t rule_hits[$RULE_COUNT] = {};
+
+/// <summary>
+/// Write how many times each rule matched to a profile.
+/// </summary>
+/// <param name="out">The profile.</param>
+void WriteProfile(std::ostream& out)
+{
+    for (size_t rule = 0; rule < $RULE_COUNT; rule++)
+    {
+        out << "rule " << rule << " " << rule_hits[rule] << "\n";
+    }
+}
+#endif
+
+/// <summary>
+/// Helper function for $LEXER_NAME::Shift().
+/// </summary>
+/// <returns>
+/// Whether a token was found. If not, more input has to be fed first.
+/// </returns>
+bool $LEXER_NAME::ShiftHelper()
+{
+    // A regex can't be paused when fed input runs out, so tokens are only
+    // matched once there's more input than the longest token, or no more to
+    // come.
+    if (m_more && m_view.size() <= m_maxTokenLength)
+    {
+        return false;
+    }
+
+    if (m_view.empty())
+    {
+        m_type = TokenType::$EOF_TOKEN;
+        m_length = 0;
+        return true;
+    }
+
+    using vmatch = std::match_results<std::string_view::const_iterator>;
+
+    size_t max_index = 0;
+    size_t max_length = 0;
+    size_t max_priority = 0;
+
+    const std::vector<std::regex>& patterns = *m_patterns;
+    for (size_t index = 0; index < rules.size(); index++)
+    {
+        const Rule& rule = rules[index];
+
+        if (rule.Active != m_state)
+        {
+            continue;
+        }
+
+        vmatch m;
+        bool matched = std::regex_search(
+            m_view.begin(), m_view.end(), m, patterns[index]);
+        if (!matched || m.position() != 0)
+        {
+            continue;
+        }
+
+        // Ensure following cast is safe
+        if (m.length() < 0)
+        {
+            throw std::exception("$LEXER_NAME::Shift(): Length was negative.");
+        }
+        size_t length = static_cast<size_t>(std::abs(m.length()));
+
+        // Rules may be ordered by how often they match rather than how they
+        // were described, so ties go to the rule described first.
+        if (length > max_length
+            || (length == max_length && rule.Priority < max_priority))
+        {
+            max_length = length;
+            max_index = index;
+            max_priority = rule.Priority;
+        }
+    }
+
+    if (m_more && max_length == m_view.size())
+    {
+        throw std::exception("$LEXER_NAME::Shift(): Token longer than the "
+                             "maximum token length.");
+    }
+
+    if (max_length > 0)
+    {
+#if $DEBUG_MODE
+        rule_hits[max_priority]++;
+#endif
+        // A rule that rewinds leaves its text to be lexed again.
+        m_type = rules[max_index].Token;
+        m_length = rules[max_index].Rewind ? 0 : max_length;
+        m_intern = rules[max_index].Intern;
+        m_convert = rules[max_index].Convert;
+        m_view.remove_prefix(m_length);
+#if !$COUNT_LINES
+        m_line += rules[max_index].Increment;
+#endif
+        m_state = rules[max_index].Transition;
+        return true;
+    }
+    else
+    {
+        m_type = TokenType::$INVALID_TOKEN;
+        m_length = 1;
+        m_view.remove_prefix(1);
+        return true;
+    }
+}
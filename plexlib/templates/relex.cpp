@@ -0,0 +1,143 @@
+
+#include <algorithm>
+#include <vector>
+
+/// <summary>
+/// Lex a whole input, keeping what Relex() needs to lex it again after edits.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+/// <returns>The input's tokens, ending with $EOF_TOKEN.</returns>
+$LEXER_NAME::TokenStream $LEXER_NAME::LexStream(std::string_view input)
+{
+    TokenStream stream;
+    Relex(stream, input, 0, 0, input.size());
+    return stream;
+}
+
+/// <summary>
+/// Update an input's tokens after part of it was replaced. Tokens before the
+/// edit are kept unless lexing them read as far as the edit. Lexing starts
+/// again after the last one kept, and stops once it's at the end of an old
+/// token after the edit in the state it was in then, since the old tokens
+/// from there on will be the same. They're moved along to make up for the
+/// edit, which is much quicker than lexing them again.
+/// </summary>
+/// <param name="stream">
+/// The tokens from before the edit, which are updated. If empty, the whole
+/// input is lexed.
+/// </param>
+/// <param name="input">The text after the edit.</param>
+/// <param name="offset">Where the edit starts.</param>
+/// <param name="removed">How many bytes the edit removed.</param>
+/// <param name="inserted">How many bytes it inserted instead.</param>
+void $LEXER_NAME::Relex(TokenStream& stream,
+                        std::string_view input,
+                        size_t offset,
+                        size_t removed,
+                        size_t inserted)
+{
+    std::vector<Lexed>& tokens = stream.Tokens;
+    std::vector<LexerState>& states = stream.States;
+    std::vector<size_t>& reaches = stream.Reaches;
+
+    // How far lexing has read only ever grows, so the tokens to keep are the
+    // ones before the first that read as far as the edit.
+    auto first = std::upper_bound(reaches.begin(), reaches.end(), offset);
+    auto keep = static_cast<size_t>(first - reaches.begin());
+
+    auto end = [&tokens](size_t token) {
+        return tokens[token].Offset + tokens[token].Length;
+    };
+
+    size_t start = keep == 0 ? 0 : end(keep - 1);
+    $LEXER_NAME lex(TextInput(), input);
+    Checkpoint checkpoint{};
+    checkpoint.Offset = start;
+    checkpoint.State = keep == 0 ? LexerState::__initial__ : states[keep - 1];
+    checkpoint.Line = keep == 0 ? 1 : tokens[keep - 1].Line;
+    checkpoint.LineStart = start == 0 ? 0 : input.rfind('\n', start - 1) + 1;
+    checkpoint.Reach = keep == 0 ? 0 : reaches[keep - 1];
+    lex.Restore(checkpoint);
+
+    // Intern into the stream's symbols, so symbols stay the same across edits.
+    std::swap(lex.m_symbols, stream.Symbols);
+    lex.Shift();
+
+    // Old tokens ending before the end of the edit can't line up with new ones.
+    size_t edited = offset + removed;
+    size_t old = keep;
+    while (old < tokens.size() && end(old) < edited)
+    {
+        old++;
+    }
+
+    std::vector<Lexed> relexed;
+    std::vector<LexerState> relexedStates;
+    std::vector<size_t> relexedReaches;
+    size_t match = tokens.size();
+    while (true)
+    {
+        const Lexed& token = lex.m_tokens[lex.m_first];
+        relexed.push_back(token);
+        relexedStates.push_back(lex.m_state);
+        relexedReaches.push_back(lex.m_reach);
+        if (token.Type == TokenType::$EOF_TOKEN)
+        {
+            break;
+        }
+
+        size_t cursor = token.Offset + token.Length;
+        while (old < tokens.size() && end(old) - removed + inserted < cursor)
+        {
+            old++;
+        }
+
+        if (old < tokens.size() && end(old) - removed + inserted == cursor
+            && states[old] == lex.m_state
+            && tokens[old].Type != TokenType::$EOF_TOKEN)
+        {
+            match = old;
+            break;
+        }
+
+        lex.Shift();
+    }
+    std::swap(lex.m_symbols, stream.Symbols);
+
+    // Move the old tokens after the match along. Those on the same line as
+    // the match have their columns counted from where that line starts now.
+    if (match < tokens.size())
+    {
+        size_t lines = relexed.back().Line - tokens[match].Line;
+        size_t reach = relexedReaches.back();
+        for (size_t token = match + 1; token < tokens.size(); token++)
+        {
+            Lexed& moved = tokens[token];
+            bool sameLine = moved.Offset - moved.Column + 1 <= end(match);
+            moved.Offset = moved.Offset - removed + inserted;
+            moved.Line += lines;
+            if (sameLine)
+            {
+                moved.Column = moved.Offset - lex.m_lineStart + 1;
+            }
+
+            reaches[token] = std::max(reaches[token] - removed + inserted,
+                                      reach);
+        }
+    }
+
+    // Put the new tokens in place of the ones between the kept tokens and
+    // the match.
+    size_t replaced = std::min(match + 1, tokens.size()) - keep;
+    auto splice = [keep, replaced](auto& values, const auto& with) {
+        values.erase(values.begin() + static_cast<std::ptrdiff_t>(keep),
+                     values.begin()
+                         + static_cast<std::ptrdiff_t>(keep + replaced));
+        values.insert(values.begin() + static_cast<std::ptrdiff_t>(keep),
+                      with.begin(),
+                      with.end());
+    };
+    splice(tokens, relexed);
+    splice(states, relexedStates);
+    splice(reaches, relexedReaches);
+}
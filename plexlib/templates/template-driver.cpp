@@ -0,0 +1,287 @@
+/// <summary>
+/// Read the contents of a file in as a string.
+/// </summary>
+/// <param name="path">Path to the file to read the contents of.</param>
+/// <returns>The contents of the file.</returns>
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream in(path);
+    std::string data;
+
+    if (!in)
+    {
+        throw std::exception("ReadFile(): Unable to open the input file.");
+    }
+
+    // Pipes and other special files have no size to reserve up front.
+    if (std::filesystem::is_regular_file(path))
+    {
+        data.reserve(std::filesystem::file_size(path));
+    }
+    data.assign(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+
+    return data;
+}
+
+$FILE_INPUT
+#if $DEBUG_MODE // Used to include/exclude driver code. Filled in by templater.
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Runs the lexer, writing all the tokens it generates to an output file.
+/// </summary>
+/// <param name="inputPath">Path to file to lex.</param>
+/// <param name="outputPath">Path to output file.</param>
+/// <returns>How many tokens were written, including the end of file.</returns>
+size_t RunLexer(const std::filesystem::path& inputPath,
+                const std::filesystem::path& outputPath)
+{
+    $LEXER_NAME lex(inputPath);
+
+    std::ofstream out(outputPath);
+    size_t tokens = 1;
+
+    while (lex.PeekToken() != TokenType::$EOF_TOKEN)
+    {
+        out << lex.PeekLine() << ": "
+            << ToString(lex.PeekToken(), lex.PeekText()) << "\n";
+        lex.Shift();
+        tokens++;
+    }
+
+    out << lex.PeekLine() << ": " << ToString(lex.PeekToken(), lex.PeekText())
+        << "\n";
+    return tokens;
+}
+
+struct BatchJob
+{
+    std::filesystem::path Input;  // file to lex
+    std::filesystem::path Output; // where its tokens go
+    uintmax_t Size = 0;           // input's size in bytes
+    size_t Tokens = 0;            // how many tokens it had
+    std::string Error;            // why it couldn't be lexed, if it couldn't
+};
+
+/// <summary>
+/// Get where a file's tokens go under a batch's output directory. The file's
+/// whole path is mirrored there, minus any root and any "..", so files with
+/// the same name in different directories don't overwrite each other.
+/// </summary>
+/// <param name="outputDir">Directory to write tokens to.</param>
+/// <param name="input">File to lex.</param>
+/// <returns>Path to write the file's tokens to.</returns>
+std::filesystem::path BatchOutput(const std::filesystem::path& outputDir,
+                                  const std::filesystem::path& input)
+{
+    std::filesystem::path output = outputDir;
+    for (const auto& part : input.lexically_normal().relative_path())
+    {
+        if (part != ".." && part != ".")
+        {
+            output /= part;
+        }
+    }
+    return output;
+}
+
+/// <summary>
+/// Runs the lexer over many files on one thread per processor, writing each
+/// file's tokens under an output directory, at the same path the file was
+/// given by or found at.
+///
+/// The threads share a single list of files, largest first, and an atomic
+/// index into it. Each thread takes the next file whenever it finishes one,
+/// so no thread sits idle while there are files left to lex. Files that
+/// can't be found, read or written are reported and the rest are still lexed.
+/// </summary>
+/// <param name="outputDir">Directory to write tokens to.</param>
+/// <param name="inputs">Files and directories to lex.</param>
+/// <returns>Whether every file was lexed.</returns>
+bool RunBatch(const std::filesystem::path& outputDir,
+              const std::vector<std::filesystem::path>& inputs)
+{
+    namespace fs = std::filesystem;
+    std::vector<BatchJob> jobs;
+
+    for (const fs::path& input : inputs)
+    {
+        // A directory that can't be walked any further keeps the files found
+        // in it so far.
+        try
+        {
+            if (!fs::is_directory(input))
+            {
+                jobs.push_back(
+                    { input, BatchOutput(outputDir, input), 0, 0, {} });
+                continue;
+            }
+
+            for (const auto& entry : fs::recursive_directory_iterator(
+                     input, fs::directory_options::skip_permission_denied))
+            {
+                if (entry.is_regular_file())
+                {
+                    fs::path output = BatchOutput(outputDir, entry.path());
+                    jobs.push_back({ entry.path(), output, 0, 0, {} });
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            jobs.push_back({ input, {}, 0, 0, e.what() });
+        }
+    }
+
+    // Paths that only differ by a root or ".." could still end up at the same
+    // output, and a file given twice would be lexed twice.
+    std::map<fs::path, size_t> outputs;
+    for (size_t index = 0; index < jobs.size(); index++)
+    {
+        BatchJob& job = jobs[index];
+        if (!job.Error.empty())
+        {
+            continue;
+        }
+
+        auto [taken, added] = outputs.emplace(job.Output, index);
+        if (!added)
+        {
+            job.Error = "Tokens would overwrite those of "
+                        + jobs[taken->second].Input.string();
+        }
+    }
+
+    // Lex the largest files first, so the last to finish are small ones.
+    std::vector<size_t> order(jobs.size());
+    for (size_t index = 0; index < jobs.size(); index++)
+    {
+        std::error_code error;
+        jobs[index].Size = fs::file_size(jobs[index].Input, error);
+        jobs[index].Size = error ? 0 : jobs[index].Size;
+        order[index] = index;
+    }
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        return jobs[a].Size > jobs[b].Size;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next = 0;
+    auto work = [&jobs, &order, &next]() {
+        for (size_t index = next++; index < order.size(); index = next++)
+        {
+            BatchJob& job = jobs[order[index]];
+            if (!job.Error.empty())
+            {
+                continue;
+            }
+
+            try
+            {
+                fs::create_directories(job.Output.parent_path());
+                job.Tokens = RunLexer(job.Input, job.Output);
+            }
+            catch (const std::exception& e)
+            {
+                job.Error = e.what();
+            }
+        }
+    };
+
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    threads = std::min(threads, std::max<size_t>(jobs.size(), 1));
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < threads; thread++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+
+    // Report files in the order they were given, not the order they were lexed.
+    uintmax_t bytes = 0;
+    size_t tokens = 0, failed = 0;
+    for (const BatchJob& job : jobs)
+    {
+        if (!job.Error.empty())
+        {
+            std::cout << job.Input.string() << ": " << job.Error << "\n";
+            failed++;
+            continue;
+        }
+        bytes += job.Size;
+        tokens += job.Tokens;
+    }
+
+    std::cout << "Lexed " << jobs.size() - failed << " files, " << bytes
+              << " bytes, " << tokens << " tokens in " << time.count()
+              << " s on " << threads << " threads\n";
+    return failed == 0;
+}
+
+/// <summary>
+/// Save how many times the lexer used each of its rules and states, so
+/// Plexiglass can lay the lexer out for inputs like the one it ran on.
+/// </summary>
+/// <param name="path">Path to the profile.</param>
+void SaveProfile(std::string path)
+{
+    std::ofstream out(path);
+    out << "plexiglass-profile $PROFILE_KEY\n";
+    WriteProfile(out);
+}
+
+/// <summary>
+/// Main entry point for lexer driver code.
+/// </summary>
+/// <param name="argc">Number of command line parameters.</param>
+/// <param name="argv">Command line parameters.</param>
+/// <returns>
+/// 0 if the lexer ran, 1 if some of a batch's files couldn't be lexed, -1 if
+/// command line parameters were bad.
+/// </returns>
+int main(int argc, char** argv)
+{
+    argc--; // discard program name
+    argv++;
+
+    if (argc >= 3 && std::string_view(argv[0]) == "--batch")
+    {
+        std::vector<std::filesystem::path> inputs(argv + 2, argv + argc);
+        return RunBatch(argv[1], inputs) ? 0 : 1;
+    }
+
+    if (argc != 2 && argc != 3)
+    {
+        std::cout << "Invalid arguments. Call with input and output "
+                     "filenames, and optionally a profile to save, or with "
+                     "--batch, an output directory, and files and "
+                     "directories to lex.\n";
+        return -1;
+    }
+
+    std::string input = argv[0];
+    std::string output = argv[1];
+
+    RunLexer(input, output);
+    if (argc == 3)
+    {
+        SaveProfile(argv[2]);
+    }
+    return 0;
+}
+
+#endif
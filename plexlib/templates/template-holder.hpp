@@ -1,4 +1,24 @@
 const char* const header_template =
     R"iOv37132Zu(${PLEXLIB_HEADER_TEMPLATE_CONTENT})iOv37132Zu";
-const char* const code_template =
-    R"iOv37132Zu(${PLEXLIB_CODE_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const code_template[] = {
+    R"iOv37132Zu(${PLEXLIB_CODE_TEMPLATE_CONTENT})iOv37132Zu",
+    R"iOv37132Zu(${PLEXLIB_PEEK_TEMPLATE_CONTENT})iOv37132Zu",
+    R"iOv37132Zu(${PLEXLIB_SHIFT_TEMPLATE_CONTENT})iOv37132Zu",
+    R"iOv37132Zu(${PLEXLIB_DRIVER_TEMPLATE_CONTENT})iOv37132Zu"
+};
+const char* const regex_template =
+    R"iOv37132Zu(${PLEXLIB_REGEX_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const automaton_template =
+    R"iOv37132Zu(${PLEXLIB_AUTOMATON_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const convert_template =
+    R"iOv37132Zu(${PLEXLIB_CONVERT_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const read_template =
+    R"iOv37132Zu(${PLEXLIB_READ_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const mmap_template =
+    R"iOv37132Zu(${PLEXLIB_MMAP_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const parallel_template =
+    R"iOv37132Zu(${PLEXLIB_PARALLEL_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const relex_template =
+    R"iOv37132Zu(${PLEXLIB_RELEX_TEMPLATE_CONTENT})iOv37132Zu";
+const char* const coroutine_template =
+    R"iOv37132Zu(${PLEXLIB_COROUTINE_TEMPLATE_CONTENT})iOv37132Zu";
@@ -0,0 +1,177 @@
+/// <summary>
+/// Retrieve the line the next token starts on.
+/// </summary>
+/// <returns>The line the next token starts on.</returns>
+size_t $LEXER_NAME::PeekLine() const
+{
+    return m_tokens[m_first].Line;
+}
+
+/// <summary>
+/// Retrieve how far into the input the next token starts.
+/// </summary>
+/// <returns>The next token's offset, in bytes.</returns>
+size_t $LEXER_NAME::PeekOffset() const
+{
+    return m_tokens[m_first].Offset;
+}
+
+/// <summary>
+/// Retrieve the column the next token starts at.
+/// </summary>
+/// <returns>
+/// The next token's column, counted in bytes from 1 at the start of its line.
+/// </returns>
+size_t $LEXER_NAME::PeekColumn() const
+{
+    return m_tokens[m_first].Column;
+}
+
+/// <summary>
+/// Retrieve the next TokenType without removing it.
+/// </summary>
+/// <returns>
+/// The next TokenType, or $NOTHING_TOKEN if input being fed ran out first.
+/// </returns>
+TokenType $LEXER_NAME::PeekToken() const
+{
+    return m_count > 0 ? m_tokens[m_first].Type : TokenType::$NOTHING_TOKEN;
+}
+
+/// <summary>
+/// Retrieve the next token's text without removing it.
+/// </summary>
+/// <returns>
+/// The next token's text. It points into the lexer's input, so it stays valid
+/// for as long as the lexer does, or until the next Shift() when streaming.
+/// </returns>
+std::string_view $LEXER_NAME::PeekText() const
+{
+    if (m_count == 0)
+    {
+        return std::string_view();
+    }
+
+    const Lexed& token = m_tokens[m_first];
+    return std::string_view(m_view.data() - (m_offset - token.Offset),
+                            token.Length);
+}
+
+/// <summary>
+/// Retrieve the next token's symbol without removing it.
+/// </summary>
+/// <returns>
+/// The next token's symbol in Symbols(), or no_symbol if its rule doesn't
+/// intern it.
+/// </returns>
+size_t $LEXER_NAME::PeekSymbol() const
+{
+    return m_count > 0 ? m_tokens[m_first].Symbol : no_symbol;
+}
+
+/// <summary>
+/// Retrieve the next token's value as an integer, without removing it.
+/// </summary>
+/// <returns>
+/// The value of the next token, if its rule converts it to an integer or from
+/// hex, or 0 if not.
+/// </returns>
+int64_t $LEXER_NAME::PeekInteger() const
+{
+    return m_count > 0 ? m_tokens[m_first].Integer : 0;
+}
+
+/// <summary>
+/// Retrieve the next token's value as a float, without removing it.
+/// </summary>
+/// <returns>
+/// The value of the next token, if its rule converts it to anything, or 0 if
+/// not.
+/// </returns>
+double $LEXER_NAME::PeekFloat() const
+{
+    return m_count > 0 ? m_tokens[m_first].Float : 0;
+}
+
+/// <summary>
+/// Retrieve the TokenType of a token after the next one, lexing as far ahead
+/// as needed. Tokens lexed ahead aren't lexed again when they're reached.
+/// </summary>
+/// <param name="ahead">
+/// How many tokens past the next one to look, up to lookahead.
+/// </param>
+/// <returns>
+/// The token's TokenType, or $NOTHING_TOKEN if input being fed ran out first.
+/// </returns>
+TokenType $LEXER_NAME::PeekToken(size_t ahead)
+{
+    if (ahead > lookahead)
+    {
+        throw std::exception("$LEXER_NAME::PeekToken(): Can't look that far "
+                             "ahead.");
+    }
+
+    while (m_count <= ahead)
+    {
+        if (!LexAhead())
+        {
+            return TokenType::$NOTHING_TOKEN;
+        }
+    }
+
+    return m_tokens[(m_first + ahead) % m_tokens.size()].Type;
+}
+
+/// <summary>
+/// Retrieve the text of a token after the next one, lexing as far ahead as
+/// needed.
+/// </summary>
+/// <param name="ahead">
+/// How many tokens past the next one to look, up to lookahead.
+/// </param>
+/// <returns>
+/// The token's text, or nothing if input being fed ran out first. It stays
+/// valid as long as the next token's text does.
+/// </returns>
+std::string_view $LEXER_NAME::PeekText(size_t ahead)
+{
+    if (PeekToken(ahead) == TokenType::$NOTHING_TOKEN)
+    {
+        return std::string_view();
+    }
+
+    const Lexed& token = m_tokens[(m_first + ahead) % m_tokens.size()];
+    return std::string_view(m_view.data() - (m_offset - token.Offset),
+                            token.Length);
+}
+
+/// <summary>
+/// Retrieve the symbol of a token after the next one, lexing as far ahead as
+/// needed.
+/// </summary>
+/// <param name="ahead">
+/// How many tokens past the next one to look, up to lookahead.
+/// </param>
+/// <returns>
+/// The token's symbol, or no_symbol if its rule doesn't intern it or input
+/// being fed ran out first.
+/// </returns>
+size_t $LEXER_NAME::PeekSymbol(size_t ahead)
+{
+    if (PeekToken(ahead) == TokenType::$NOTHING_TOKEN)
+    {
+        return no_symbol;
+    }
+
+    return m_tokens[(m_first + ahead) % m_tokens.size()].Symbol;
+}
+
+/// <summary>
+/// Get the text interned so far, to look symbols up in.
+/// </summary>
+/// <returns>The lexer's symbol table.</returns>
+const SymbolTable& $LEXER_NAME::Symbols() const
+{
+    return m_symbols;
+}
+
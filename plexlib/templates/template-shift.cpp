@@ -0,0 +1,362 @@
+#if $COUNT_LINES
+/// <summary>
+/// Count the newlines in some text, eight bytes at a time.
+/// </summary>
+/// <param name="text">The text.</param>
+/// <returns>How many newlines there are.</returns>
+size_t CountNewlines(std::string_view text)
+{
+    constexpr uint64_t ones = 0x0101010101010101;
+    constexpr uint64_t lows = 0x7F7F7F7F7F7F7F7F;
+    constexpr uint64_t newlines = ones * '\n';
+
+    size_t count = 0;
+    size_t index = 0;
+    for (; index + 8 <= text.size(); index += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, text.data() + index, 8);
+
+        // Newlines become zero bytes, then only zero bytes get their high bit
+        // set. Multiplying adds those bits up in the top byte.
+        word ^= newlines;
+        uint64_t zeros = ~(((word & lows) + lows) | word | lows);
+        count += static_cast<size_t>(((zeros >> 7) * ones) >> 56);
+    }
+
+    for (; index < text.size(); index++)
+    {
+        count += text[index] == '\n';
+    }
+
+    return count;
+}
+#endif
+
+/// <summary>
+/// Advance the lexer to the next token. When input is being fed, the next
+/// token is $NOTHING_TOKEN if more input is needed to finish it.
+/// </summary>
+void $LEXER_NAME::Shift()
+{
+    if (m_count > 0)
+    {
+        m_first = (m_first + 1) % m_tokens.size();
+        m_count--;
+    }
+
+    if (m_count == 0)
+    {
+        LexAhead();
+    }
+}
+
+/// <summary>
+/// Lex the token after the last one lexed, adding it to the tokens waiting to
+/// be shifted past.
+/// </summary>
+/// <returns>
+/// Whether there was a complete token. If not, more input has to be fed first.
+/// </returns>
+bool $LEXER_NAME::LexAhead()
+{
+    m_type = TokenType::$NOTHING_TOKEN;
+    size_t column = 0;
+    while (m_type == TokenType::$NOTHING_TOKEN)
+    {
+        m_intern = false;
+        m_convert = Conversion::None;
+        Refill();
+        if (!ShiftHelper())
+        {
+            return false;
+        }
+
+        std::string_view text(m_view.data() - m_length, m_length);
+#if $COUNT_LINES
+        m_line += CountNewlines(text);
+#endif
+
+        // Columns count bytes from just after the last newline before the
+        // token, which can only have moved if the token has newlines in it.
+        column = m_offset - m_lineStart + 1;
+        size_t newline = text.rfind('\n');
+        if (newline != std::string_view::npos)
+        {
+            m_lineStart = m_offset + newline + 1;
+        }
+        m_offset += m_length;
+
+        // There was more input than the longest token, so a token that used
+        // all of it could have continued past what was read.
+        if (m_read && m_view.empty())
+        {
+            throw std::exception("$LEXER_NAME::Shift(): Token longer than "
+                                 "the maximum token length.");
+        }
+
+        if (m_skipped[static_cast<size_t>(m_type)])
+        {
+            m_type = TokenType::$NOTHING_TOKEN;
+        }
+    }
+
+    // Text is interned and converted while it's still in cache from being
+    // matched.
+    std::string_view text(m_view.data() - m_length, m_length);
+    size_t symbol = m_intern ? m_symbols.Intern(text) : no_symbol;
+    int64_t integer = 0;
+    double real = 0;
+#if $CONVERT_NUMBERS
+    if (m_convert != Conversion::None)
+    {
+        ConvertNumber(text, m_convert, integer, real);
+    }
+#endif
+
+    m_tokens[(m_first + m_count) % m_tokens.size()] = {
+        m_type, m_offset - m_length, m_length, m_line, column, symbol, integer,
+        real
+    };
+    m_count++;
+    return true;
+}
+
+/// <summary>
+/// Get how much of the input before m_view is still needed, for the text of
+/// tokens that haven't been shifted past.
+/// </summary>
+/// <returns>How many bytes before m_view are still needed.</returns>
+size_t $LEXER_NAME::Unshifted() const
+{
+    return m_count > 0 ? m_offset - m_tokens[m_first].Offset : 0;
+}
+
+/// <summary>
+/// Give the lexer more input. Text from tokens already shifted past is no
+/// longer valid afterwards, since only the input still needed is kept.
+/// </summary>
+/// <param name="input">
+/// The input. It's copied, so it needn't outlive the call.
+/// </param>
+void $LEXER_NAME::Feed(std::string_view input)
+{
+    size_t keep = Unshifted();
+    m_reference.erase(0, m_reference.size() - m_view.size() - keep);
+    m_reference.append(input);
+    m_view = std::string_view(m_reference).substr(keep);
+}
+
+/// <summary>
+/// Advance to the next token of the input fed so far.
+/// </summary>
+/// <returns>
+/// Whether there was a complete token. If not, more input must be fed, or the
+/// input finished, first.
+/// </returns>
+bool $LEXER_NAME::Next()
+{
+    Shift();
+    return m_count > 0;
+}
+
+/// <summary>
+/// Mark the end of the input fed to the lexer. Next() then lexes whatever is
+/// left, followed by $EOF_TOKEN.
+/// </summary>
+void $LEXER_NAME::Finish()
+{
+    m_more = false;
+}
+
+/// <summary>
+/// Lex up to count tokens into arrays, starting with the next token, without
+/// returning between tokens. The lexer is left on the token after the last
+/// one written. Writing stops early after $EOF_TOKEN, or when input being fed
+/// runs out.
+/// </summary>
+/// <param name="batch">The arrays to write tokens into.</param>
+/// <param name="count">How many tokens the arrays have room for.</param>
+/// <returns>How many tokens were written.</returns>
+size_t $LEXER_NAME::LexBatch(const TokenBatch& batch, size_t count)
+{
+    // A lexer being fed input that ran out is waiting to lex its next token.
+    if (m_count == 0)
+    {
+        Shift();
+    }
+
+    size_t written = 0;
+    while (written < count && m_count > 0)
+    {
+        const Lexed& token = m_tokens[m_first];
+        if (batch.Types)
+        {
+            batch.Types[written] = token.Type;
+        }
+        if (batch.Offsets)
+        {
+            batch.Offsets[written] = token.Offset;
+        }
+        if (batch.Lengths)
+        {
+            batch.Lengths[written] = token.Length;
+        }
+        if (batch.Lines)
+        {
+            batch.Lines[written] = token.Line;
+        }
+        if (batch.Columns)
+        {
+            batch.Columns[written] = token.Column;
+        }
+        if (batch.Symbols)
+        {
+            batch.Symbols[written] = token.Symbol;
+        }
+        if (batch.Integers)
+        {
+            batch.Integers[written] = token.Integer;
+        }
+        if (batch.Floats)
+        {
+            batch.Floats[written] = token.Float;
+        }
+        written++;
+
+        if (token.Type == TokenType::$EOF_TOKEN)
+        {
+            break;
+        }
+        Shift();
+    }
+
+    return written;
+}
+
+/// <summary>
+/// Choose which tokens the lexer produces. The rest are skipped as they're
+/// lexed, as if their rules produced nothing, so they never reach
+/// PeekToken(), iterators or LexBatch(). $EOF_TOKEN is always produced.
+/// Tokens already lexed ahead that aren't wanted are dropped.
+/// </summary>
+/// <param name="wanted">The TokenTypes to produce.</param>
+void $LEXER_NAME::Filter(const TokenFilter& wanted)
+{
+    m_skipped = ~wanted;
+    m_skipped.reset(static_cast<size_t>(TokenType::$EOF_TOKEN));
+
+    size_t kept = 0;
+    for (size_t index = 0; index < m_count; index++)
+    {
+        Lexed token = m_tokens[(m_first + index) % m_tokens.size()];
+        if (!m_skipped[static_cast<size_t>(token.Type)])
+        {
+            m_tokens[(m_first + kept) % m_tokens.size()] = token;
+            kept++;
+        }
+    }
+
+    // If every token lexed ahead was dropped, lex the next wanted one.
+    bool lexedAhead = m_count > 0;
+    m_count = kept;
+    if (lexedAhead && m_count == 0)
+    {
+        LexAhead();
+    }
+}
+
+/// <summary>
+/// Save where the lexer is, to go back to later with Restore().
+/// </summary>
+/// <returns>The checkpoint.</returns>
+$LEXER_NAME::Checkpoint $LEXER_NAME::Save() const
+{
+    Checkpoint checkpoint{};
+    checkpoint.Tokens = m_tokens;
+    checkpoint.First = m_first;
+    checkpoint.Count = m_count;
+    checkpoint.Offset = m_offset;
+    checkpoint.State = m_state;
+    checkpoint.Line = m_line;
+    checkpoint.LineStart = m_lineStart;
+#if $AUTOMATON
+    checkpoint.Scan = m_scan;
+#endif
+#if $INCREMENTAL
+    checkpoint.Reach = m_reach;
+#endif
+    return checkpoint;
+}
+
+/// <summary>
+/// Go back, or forward, to where the lexer was when a checkpoint was saved.
+/// Nothing is lexed again until the lexer passes the tokens it had lexed
+/// then.
+/// </summary>
+/// <param name="checkpoint">A checkpoint saved from this lexer.</param>
+void $LEXER_NAME::Restore(const Checkpoint& checkpoint)
+{
+    // Streamed and fed input is thrown away once it's been lexed.
+    if (m_maxTokenLength > 0)
+    {
+        throw std::exception("$LEXER_NAME::Restore(): Can't restore a lexer "
+                             "whose input is streamed or fed.");
+    }
+
+    const char* end = m_view.data() + m_view.size();
+    const char* cursor = m_view.data()
+                         + (static_cast<std::ptrdiff_t>(checkpoint.Offset)
+                            - static_cast<std::ptrdiff_t>(m_offset));
+    m_view = std::string_view(cursor, static_cast<size_t>(end - cursor));
+
+    m_tokens = checkpoint.Tokens;
+    m_first = checkpoint.First;
+    m_count = checkpoint.Count;
+    m_offset = checkpoint.Offset;
+    m_state = checkpoint.State;
+    m_line = checkpoint.Line;
+    m_lineStart = checkpoint.LineStart;
+#if $AUTOMATON
+    m_scan = checkpoint.Scan;
+#endif
+#if $INCREMENTAL
+    m_reach = checkpoint.Reach;
+#endif
+}
+
+/// <summary>
+/// When streaming, make sure there's more input left than the longest token,
+/// unless the input has run out.
+/// </summary>
+void $LEXER_NAME::Refill()
+{
+    if (!m_read || m_view.size() > m_maxTokenLength)
+    {
+        return;
+    }
+
+    // Everything before the tokens not yet shifted past has been lexed, so it
+    // can go. Unless tokens have been lexed ahead, the buffer is never resized
+    // past what the constructor reserved.
+    size_t keep = Unshifted();
+    m_reference.erase(0, m_reference.size() - m_view.size() - keep);
+
+    size_t size = m_reference.size();
+    m_reference.resize(keep + m_chunkSize + m_maxTokenLength + 1);
+    while (m_read && size - keep <= m_maxTokenLength)
+    {
+        size_t read =
+            m_read(m_reference.data() + size, m_reference.size() - size);
+        if (read == 0)
+        {
+            m_read = nullptr;
+        }
+        size += read;
+    }
+    m_reference.resize(size);
+
+    m_view = std::string_view(m_reference).substr(keep);
+}
+
+$ENGINE$PARALLEL$RELEX
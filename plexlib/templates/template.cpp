@@ -1,9 +1,12 @@
 #include "$LEXER_NAME.hpp"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
-#include <regex>
-#include <vector>
+#include <utility>
 
 std::string ReadFile(const std::filesystem::path& path);
 
@@ -12,64 +15,22 @@ enum class LexerState
     $LEXER_STATES
 };
 
-struct Rule
+// What a rule's convert action turns the text it matched into, if anything.
+enum class Conversion
 {
-    /// <summary>
-    /// Construct a Rule.
-    /// </summary>
-    /// <param name="active">The state the rule is active in.</param>
-    /// <param name="pattern">
-    /// A regular expression describing what the rule matches.
-    /// </param>
-    /// <param name="transition">The state the rule transitions to.</param>
-    /// <param name="token">The TokenType produced.</param>
-    /// <param name="increment">
-    /// How much to change the current line number by.
-    /// </param>
-    Rule(LexerState active,
-         const char* pattern,
-         LexerState transition,
-         TokenType token,
-         int increment)
-        : Active(active)
-        , Pattern(pattern)
-        , Transition(transition)
-        , Token(token)
-        , Increment(increment)
-    {
-    }
-
-    LexerState Active;
-    std::regex Pattern;
-    LexerState Transition;
-    TokenType Token;
-    int Increment;
+    None,
+    Integer,
+    Float,
+    Hex
 };
-
-/// <summary>
-/// Get the rules to be used by the lexer.
-/// </summary>
-/// <returns>The rules to be used by the lexer.</returns>
-std::vector<Rule> GetRules()
-{
-    $EXPRESSIONS
-
-    // This name was chosen to avoid conflicts with the expression names above.
-    // __names__ are reserved by the lexer for internal use.
-    std::vector<Rule> __rules__;
-
-    $LEXER_RULES
-
-    return __rules__;
-}
-
+$CONVERSION
 /// <summary>
 /// Get a human-readable string representation of a token.
 /// </summary>
 /// <param name="type">The token's type.</param>
 /// <param name="text">The token's text.</param>
 /// <returns>String representation of the token.</returns>
-std::string ToString(TokenType type, const std::string& text)
+std::string ToString(TokenType type, std::string_view text)
 {
     std::string str;
     switch (type)
@@ -79,206 +40,235 @@ std::string ToString(TokenType type, const std::string& text)
 
     if (!text.empty())
     {
-        str += " " + text;
+        str += " ";
+        str += text;
     }
 
     return str;
 }
 
 /// <summary>
-/// Construct $LEXER_NAME.
+/// Hash some text eight bytes at a time.
 /// </summary>
-/// <param name="path">Path to the file to lex.</param>
-$LEXER_NAME::$LEXER_NAME(const std::filesystem::path& path)
+/// <param name="text">The text.</param>
+/// <returns>The text's hash.</returns>
+size_t HashText(std::string_view text)
 {
-    m_reference = ReadFile(path);
-    m_view = m_reference;
-    m_line = 1;
-    m_state = LexerState::__initial__;
-    Shift();
-}
+    constexpr uint64_t multiplier = 0x9E3779B97F4A7C15;
+    uint64_t hash = text.size() * multiplier;
+    size_t index = 0;
 
-/// <summary>
-/// Retrieve the line the next token starts on.
-/// </summary>
-/// <returns>The line the next token starts on.</returns>
-size_t $LEXER_NAME::PeekLine() const
-{
-    return m_line;
+    for (; index + 8 <= text.size(); index += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, text.data() + index, 8);
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t word = 0;
+    std::memcpy(&word, text.data() + index, text.size() - index);
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 32;
+
+    return static_cast<size_t>(hash);
 }
 
 /// <summary>
-/// Retrieve the next TokenType without removing it.
+/// Get the symbol for some text, interning it if it hasn't been already.
 /// </summary>
-/// <returns>The next TokenType.</returns>
-TokenType $LEXER_NAME::PeekToken() const
+/// <param name="text">The text.</param>
+/// <returns>
+/// The text's symbol. Symbols count up from 0 in the order texts were first
+/// interned.
+/// </returns>
+size_t SymbolTable::Intern(std::string_view text)
 {
-    return m_type;
+    if (m_entries.size() * 2 >= m_slots.size())
+    {
+        Grow();
+    }
+
+    size_t hash = HashText(text);
+    size_t mask = m_slots.size() - 1;
+    size_t slot = hash & mask;
+    for (; m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        size_t symbol = m_slots[slot] - 1;
+        if (m_entries[symbol].Hash == hash && Text(symbol) == text)
+        {
+            return symbol;
+        }
+    }
+
+    // Copy the text to the end of the last block, or into a new one if it
+    // won't fit. Blocks are never resized, so texts already copied stay put.
+    constexpr size_t block_size = 65536;
+    if (m_blocks.empty()
+        || m_blocks.back().capacity() - m_blocks.back().size() < text.size())
+    {
+        m_blocks.emplace_back().reserve(std::max(block_size, text.size()));
+    }
+    std::vector<char>& block = m_blocks.back();
+    m_entries.push_back({ m_blocks.size() - 1, block.size(), text.size(),
+                          hash });
+    block.insert(block.end(), text.begin(), text.end());
+
+    m_slots[slot] = m_entries.size();
+    return m_entries.size() - 1;
 }
 
 /// <summary>
-/// Retrieve the next token's text without removing it.
+/// Get the text a symbol stands for.
 /// </summary>
-/// <returns>The next token's text.</returns>
-std::string $LEXER_NAME::PeekText() const
+/// <param name="symbol">The symbol.</param>
+/// <returns>
+/// The symbol's text, which stays valid for as long as the table does.
+/// </returns>
+std::string_view SymbolTable::Text(size_t symbol) const
 {
-    return m_text;
+    const Entry& entry = m_entries[symbol];
+    return std::string_view(m_blocks[entry.Block].data() + entry.Offset,
+                            entry.Length);
 }
 
 /// <summary>
-/// Advance the lexer to the next token.
+/// Get how many symbols there are.
 /// </summary>
-void $LEXER_NAME::Shift()
+/// <returns>How many symbols there are, one more than the largest.</returns>
+size_t SymbolTable::Size() const
 {
-    m_type = TokenType::$NOTHING_TOKEN;
-    while (m_type == TokenType::$NOTHING_TOKEN)
-    {
-        ShiftHelper();
-    }
+    return m_entries.size();
 }
 
 /// <summary>
-/// Helper function for $LEXER_NAME::Shift().
+/// Double the number of slots, and put every symbol back in them.
 /// </summary>
-void $LEXER_NAME::ShiftHelper()
+void SymbolTable::Grow()
 {
-    if (m_view.empty())
-    {
-        m_type = TokenType::$EOF_TOKEN;
-        m_text = "";
-        return;
-    }
-
-    using vmatch = std::match_results<std::string_view::const_iterator>;
-    static std::vector<Rule> rules = GetRules();
-
-    size_t max_index = 0;
-    size_t max_length = 0;
-    std::string max_string;
+    m_slots.assign(std::max<size_t>(m_slots.size() * 2, 64), 0);
+    size_t mask = m_slots.size() - 1;
 
-    for (size_t index = 0; index < rules.size(); index++)
+    for (size_t symbol = 0; symbol < m_entries.size(); symbol++)
     {
-        Rule rule = rules[index];
-
-        if (rule.Active != m_state)
-        {
-            continue;
-        }
-
-        vmatch m;
-        bool matched =
-            std::regex_search(m_view.begin(), m_view.end(), m, rule.Pattern);
-        if (!matched || m.position() != 0)
+        size_t slot = m_entries[symbol].Hash & mask;
+        while (m_slots[slot] != 0)
         {
-            continue;
+            slot = (slot + 1) & mask;
         }
-
-        // Ensure following cast is safe
-        if (m.length() < 0)
-        {
-            throw std::exception("$LEXER_NAME::Shift(): Length was negative.");
-        }
-        size_t length = static_cast<size_t>(std::abs(m.length()));
-
-        if (length > max_length)
-        {
-            max_length = length;
-            max_index = index;
-            max_string = m.str();
-        }
-    }
-
-    if (max_length > 0)
-    {
-        m_type = rules[max_index].Token;
-        if (rules[max_index].Token != TokenType::$NOTHING_TOKEN)
-        {
-            m_text = m_view.substr(0, max_length);
-        }
-        m_view.remove_prefix(max_length);
-        m_line += rules[max_index].Increment;
-        m_state = rules[max_index].Transition;
-        return;
-    }
-    else
-    {
-        m_type = TokenType::$INVALID_TOKEN;
-        m_text = std::string(1, m_view[0]);
-        m_view.remove_prefix(1);
-        return;
+        m_slots[slot] = symbol + 1;
     }
 }
 
 /// <summary>
-/// Read the contents of a file in as a string.
+/// Construct $LEXER_NAME to lex input fed to it a piece at a time with Feed().
 /// </summary>
-/// <param name="path">Path to the file to read the contents of.</param>
-/// <returns>The contents of the file.</returns>
-std::string ReadFile(const std::filesystem::path& path)
+/// <param name="maxTokenLength">The length of the longest token.</param>
+$LEXER_NAME::$LEXER_NAME(size_t maxTokenLength)
+    : m_state(LexerState::__initial__)
+    , m_line(1)
+    , m_type(TokenType::$NOTHING_TOKEN)
+    , m_length(0)
+    , m_maxTokenLength(maxTokenLength)
+    , m_more(true)
 {
-    std::ifstream in(path);
-    std::string data;
-
-    auto fileSize = std::filesystem::file_size(path);
-    data.reserve(fileSize);
-    data.assign(std::istreambuf_iterator<char>(in),
-                std::istreambuf_iterator<char>());
-
-    return data;
+    m_view = m_reference;
 }
 
-#if $DEBUG_MODE // Used to include/exclude driver code. Filled in by templater.
-
-#include <fstream>
-#include <iostream>
-
 /// <summary>
-/// Runs the lexer, writing all the tokens it generates to an output file.
+/// Construct $LEXER_NAME to lex text it doesn't own. Nothing is copied, so
+/// the text must outlive the lexer and the text of its tokens.
 /// </summary>
-/// <param name="inputPath">Path to file to lex.</param>
-/// <param name="outputPath">Path to output file.</param>
-void RunLexer(std::string inputPath, std::string outputPath)
+/// <param name="input">The text to lex.</param>
+$LEXER_NAME::$LEXER_NAME(TextInput, std::string_view input)
+    : m_view(input)
+    , m_state(LexerState::__initial__)
+    , m_line(1)
 {
-    lexer lex(inputPath);
-
-    std::ofstream out(outputPath);
+    Shift();
+}
 
-    while (lex.PeekToken() != TokenType::PLEXIGLASS_EOF)
-    {
-        out << lex.PeekLine() << ": "
-            << ToString(lex.PeekToken(), lex.PeekText()) << "\n";
-        lex.Shift();
-    }
+/// <summary>
+/// Construct $LEXER_NAME to lex text it takes ownership of.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+$LEXER_NAME::$LEXER_NAME(TextInput, std::string&& input)
+    : m_reference(std::move(input))
+    , m_view(m_reference)
+    , m_state(LexerState::__initial__)
+    , m_line(1)
+{
+    Shift();
+}
 
-    out << lex.PeekLine() << ": " << ToString(lex.PeekToken(), lex.PeekText())
-        << "\n";
+/// <summary>
+/// Make a $LEXER_NAME to lex text it doesn't own. Nothing is copied, so the
+/// text must outlive the lexer and the text of its tokens.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+$LEXER_NAME $LEXER_NAME::FromText(std::string_view input)
+{
+    return $LEXER_NAME(TextInput(), input);
 }
 
 /// <summary>
-/// Main entry point for lexer driver code.
+/// Make a $LEXER_NAME to lex a string literal, or other text it doesn't own.
 /// </summary>
-/// <param name="argc">Number of command line parameters.</param>
-/// <param name="argv">Command line parameters.</param>
-/// <returns>
-/// 0 if the lexer ran, -1 if command line parameters were bad.
-/// </returns>
-int main(int argc, char** argv)
+/// <param name="input">The text to lex.</param>
+$LEXER_NAME $LEXER_NAME::FromText(const char* input)
 {
-    argc--; // discard program name
-    argv++;
+    return $LEXER_NAME(TextInput(), std::string_view(input));
+}
 
-    if (argc != 2)
-    {
-        std::cout << "Invalid arguments. Call with just input and output "
-                     "filenames.\n";
-        return -1;
-    }
+/// <summary>
+/// Make a $LEXER_NAME to lex text it takes ownership of.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+$LEXER_NAME $LEXER_NAME::FromText(std::string&& input)
+{
+    return $LEXER_NAME(TextInput(), std::move(input));
+}
 
-    std::string input = argv[0];
-    std::string output = argv[1];
+/// <summary>
+/// Construct $LEXER_NAME to lex a stream a chunk at a time.
+/// </summary>
+/// <param name="input">The stream to lex.</param>
+/// <param name="chunkSize">How much to read from the stream at once.</param>
+/// <param name="maxTokenLength">The length of the longest token.</param>
+$LEXER_NAME::$LEXER_NAME(std::istream& input,
+                         size_t chunkSize,
+                         size_t maxTokenLength)
+    : $LEXER_NAME(
+        [&input](char* data, size_t size) {
+            input.read(data, static_cast<std::streamsize>(size));
+            return static_cast<size_t>(input.gcount());
+        },
+        chunkSize,
+        maxTokenLength)
+{
+}
 
-    RunLexer(input, output);
-    return 0;
+/// <summary>
+/// Construct $LEXER_NAME to lex input read a chunk at a time. Only one chunk
+/// and one token's worth of input are kept in memory.
+/// </summary>
+/// <param name="read">
+/// Reads up to the given number of bytes into the given buffer, and returns
+/// how many were read, or 0 at the end of the input.
+/// </param>
+/// <param name="chunkSize">How much to read at once.</param>
+/// <param name="maxTokenLength">The length of the longest token.</param>
+$LEXER_NAME::$LEXER_NAME(std::function<size_t(char*, size_t)> read,
+                         size_t chunkSize,
+                         size_t maxTokenLength)
+    : m_state(LexerState::__initial__)
+    , m_line(1)
+    , m_read(std::move(read))
+    , m_chunkSize(chunkSize)
+    , m_maxTokenLength(maxTokenLength)
+{
+    m_reference.reserve(chunkSize + maxTokenLength + 1);
+    m_view = m_reference;
+    Shift();
 }
 
-#endif
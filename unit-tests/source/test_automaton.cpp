@@ -0,0 +1,281 @@
+#include <array>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "doctest.h"
+
+#include <automaton/automaton.hpp>
+#include <automaton/engine.hpp>
+
+using namespace plexiglass;
+
+namespace
+{
+    enum class TokenType
+    {
+        __eof__,
+        __jam__,
+        __nothing__,
+        keyword,
+        identifier,
+        number,
+        string,
+    };
+
+    enum class LexerState
+    {
+        __initial__,
+        string,
+        __jail__,
+    };
+
+    using LexerRule = Rule<TokenType, LexerState>;
+
+    constexpr auto tables = Compile([] {
+        return std::array<LexerRule, 7> { {
+            { LexerState::__initial__, "if|while", LexerState::__initial__,
+              TokenType::keyword, 0 },
+            { LexerState::__initial__, "[a-zA-Z_]\\w*", LexerState::__initial__,
+              TokenType::identifier, 0 },
+            { LexerState::__initial__, "0x[0-9a-fA-F]{1,4}|\\d+",
+              LexerState::__initial__, TokenType::number, 0 },
+            { LexerState::__initial__, "[ \\t]+", LexerState::__initial__,
+              TokenType::__nothing__, 0 },
+            { LexerState::__initial__, "\\n", LexerState::__initial__,
+              TokenType::__nothing__, 1 },
+            { LexerState::__initial__, "\"", LexerState::string,
+              TokenType::__nothing__, 0 },
+            { LexerState::string, "[^\"]*\"", LexerState::__initial__,
+              TokenType::string, 0 },
+        } };
+    });
+
+    static_assert(tables.States > 1, "Rules should compile at compile time");
+    static_assert(tables.Accept[0] == -1, "State 0 should be dead");
+
+    struct PatternRule
+    {
+        std::size_t Active;
+        std::string_view Pattern;
+    };
+
+    /// <summary>
+    /// Find how much of some text a pattern matches from its start.
+    /// </summary>
+    /// <param name="pattern">The pattern.</param>
+    /// <param name="text">The text.</param>
+    /// <returns>The length of the match, or npos if there isn't one.</returns>
+    std::size_t MatchLength(std::string_view pattern, std::string_view text)
+    {
+        std::vector<PatternRule> patterns = { { 0, pattern } };
+        auto automaton = Build<DynamicStorage>(patterns, 1);
+        REQUIRE(automaton.Result == Status::Success);
+
+        std::size_t state = automaton.Start[0];
+        std::size_t length = automaton.Accept[state] == 0 ? 0 : npos;
+        for (std::size_t i = 0; i < text.size() && state != 0; i++)
+        {
+            unsigned char byte = static_cast<unsigned char>(text[i]);
+            state = automaton.Next[state * automaton.Classes
+                                   + automaton.ByteClass[byte]];
+            if (automaton.Accept[state] == 0)
+            {
+                length = i + 1;
+            }
+        }
+
+        return length;
+    }
+
+    /// <summary>
+    /// Check whether the match a pattern finds from the start of some text
+    /// covers all of it. Like std::regex, the match isn't always the longest.
+    /// </summary>
+    /// <param name="pattern">The pattern.</param>
+    /// <param name="text">The text.</param>
+    /// <returns>Whether the match is the whole text.</returns>
+    bool Matches(std::string_view pattern, std::string_view text)
+    {
+        return MatchLength(pattern, text) == text.size();
+    }
+
+    /// <summary>
+    /// Compile a single pattern.
+    /// </summary>
+    /// <param name="pattern">The pattern.</param>
+    /// <returns>Whether the pattern compiled.</returns>
+    Status Check(std::string_view pattern)
+    {
+        std::vector<PatternRule> patterns = { { 0, pattern } };
+        return Build<DynamicStorage>(patterns, 1).Result;
+    }
+}
+
+TEST_CASE("Automaton: Lex with compiled tables")
+{
+    Lexer lexer(tables, "if iffy 0x1F 42\n\"hi there\" while");
+
+    CHECK(lexer.PeekToken() == TokenType::keyword);
+    CHECK(lexer.PeekText() == "if");
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::identifier);
+    CHECK(lexer.PeekText() == "iffy");
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::number);
+    CHECK(lexer.PeekText() == "0x1F");
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::number);
+    CHECK(lexer.PeekText() == "42");
+    CHECK(lexer.PeekLine() == 1);
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::string);
+    CHECK(lexer.PeekText() == "hi there\"");
+    CHECK(lexer.PeekLine() == 2);
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::keyword);
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::__eof__);
+}
+
+TEST_CASE("Automaton: Jam on unmatched input")
+{
+    Lexer lexer(tables, "abc $ def");
+
+    CHECK(lexer.PeekToken() == TokenType::identifier);
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::__jam__);
+    CHECK(lexer.PeekText() == "$");
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::identifier);
+    CHECK(lexer.PeekText() == "def");
+}
+
+TEST_CASE("Automaton: Quantifiers")
+{
+    CHECK(Matches("a*", ""));
+    CHECK(Matches("a*", "aaa"));
+    CHECK(Matches("a+", "a"));
+    CHECK_FALSE(Matches("a+", ""));
+    CHECK(Matches("ab?c", "ac"));
+    CHECK(Matches("ab?c", "abc"));
+    CHECK_FALSE(Matches("ab?c", "abbc"));
+    CHECK(Matches("a{3}", "aaa"));
+    CHECK_FALSE(Matches("a{3}", "aa"));
+    CHECK(Matches("a{2,}", "aaaaa"));
+    CHECK_FALSE(Matches("a{2,}", "a"));
+    CHECK(Matches("(ab){1,2}", "abab"));
+    CHECK_FALSE(Matches("(ab){1,2}", "ababab"));
+}
+
+TEST_CASE("Automaton: Classes and escapes")
+{
+    CHECK(Matches("[a-c]+", "abcba"));
+    CHECK_FALSE(Matches("[a-c]+", "abd"));
+    CHECK(Matches("[^a-c]", "d"));
+    CHECK_FALSE(Matches("[^a-c]", "b"));
+    CHECK(Matches("\\d\\w\\s", "1a "));
+    CHECK(Matches("\\D\\W\\S", "a a"));
+    CHECK(Matches("[\\d-]+", "1-2"));
+    CHECK(Matches("\\x41\\u0042\\t", "AB\t"));
+    CHECK(Matches("\\.\\*", ".*"));
+    CHECK(Matches("(?:a|b)c", "bc"));
+    CHECK(Matches(".", "x"));
+    CHECK_FALSE(Matches(".", "\n"));
+}
+
+TEST_CASE("Automaton: Reject unsupported patterns")
+{
+    CHECK(Check("^a") == Status::Unsupported);
+    CHECK(Check("a$") == Status::Unsupported);
+    CHECK(Check("\\ba") == Status::Unsupported);
+    CHECK(Check("(a)\\1") == Status::Unsupported);
+    CHECK(Check("a(?=b)") == Status::Unsupported);
+    CHECK(Check("\\u00e9") == Status::Unsupported);
+}
+
+TEST_CASE("Automaton: Alternation prefers the first alternative")
+{
+    constexpr auto alternation = Compile([] {
+        return std::array<LexerRule, 2> { {
+            { LexerState::__initial__, "a|ab", LexerState::__initial__,
+              TokenType::keyword, 0 },
+            { LexerState::__initial__, "b", LexerState::__initial__,
+              TokenType::identifier, 0 },
+        } };
+    });
+
+    Lexer lexer(alternation, "ab");
+    CHECK(lexer.PeekToken() == TokenType::keyword);
+    CHECK(lexer.PeekText() == "a");
+    lexer.Shift();
+    CHECK(lexer.PeekToken() == TokenType::identifier);
+    CHECK(lexer.PeekText() == "b");
+}
+
+TEST_CASE("Automaton: Match what std::regex matches")
+{
+    const std::pair<std::string, std::string> cases[] = {
+        { "a|ab", "ab" },
+        { "ab|a", "ab" },
+        { "dollar|dollars", "dollars" },
+        { "(a|ab)(c|bcd)", "abcd" },
+        { "(a|ab)*c", "ababc" },
+        { "a*?b", "aab" },
+        { "a+?", "aaa" },
+        { "a??a", "aa" },
+        { "a{1,3}?", "aaa" },
+        { "(?:a|b)*?b", "aabab" },
+        { "/\\*.*?\\*/", "/* a */ b */" },
+        { "x*", "y" },
+    };
+
+    for (const auto& [pattern, text] : cases)
+    {
+        CAPTURE(pattern);
+        std::smatch match;
+        REQUIRE(std::regex_search(text,
+                                  match,
+                                  std::regex(pattern),
+                                  std::regex_constants::match_continuous));
+        CHECK(MatchLength(pattern, text)
+              == static_cast<std::size_t>(match.length()));
+    }
+}
+
+TEST_CASE("Automaton: Reject malformed patterns")
+{
+    CHECK(Check("(a") == Status::Malformed);
+    CHECK(Check("a)") == Status::Malformed);
+    CHECK(Check("[a") == Status::Malformed);
+    CHECK(Check("*a") == Status::Malformed);
+    CHECK(Check("a**") == Status::Malformed);
+    CHECK(Check("a{2,1}") == Status::Malformed);
+    CHECK(Check("[z-a]") == Status::Malformed);
+    CHECK(Check("\\x4") == Status::Malformed);
+}
+
+TEST_CASE("Automaton: Report where rules fail")
+{
+    std::vector<PatternRule> patterns = { { 0, "a" }, { 0, "b|^c" } };
+    auto automaton = Build<DynamicStorage>(patterns, 1);
+
+    CHECK(automaton.Result == Status::Unsupported);
+    CHECK(automaton.ErrorRule == 1);
+    CHECK(automaton.ErrorOffset == 3);
+}
+
+TEST_CASE("Automaton: States with the same patterns share an automaton")
+{
+    std::vector<PatternRule> patterns = {
+        { 0, "a" }, { 0, "b" }, { 1, "c" }, { 2, "a" }, { 2, "b" },
+    };
+    auto automaton = Build<DynamicStorage>(patterns, 4);
+
+    REQUIRE(automaton.Result == Status::Success);
+    CHECK(automaton.Start[0] == automaton.Start[2]);
+    CHECK(automaton.Start[0] != automaton.Start[1]);
+    CHECK(automaton.Start[3] == 0);
+}
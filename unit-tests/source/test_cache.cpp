@@ -0,0 +1,103 @@
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "doctest.h"
+
+#include <automaton/automaton.hpp>
+#include <cache/cache.hpp>
+
+#include "test_files.hpp"
+
+struct CacheRule
+{
+    size_t Active;
+    std::string_view Pattern;
+};
+
+const std::vector<CacheRule> cache_rules = {
+    { 0, "[a-z]+" },
+    { 0, "[0-9]+" },
+    { 1, "\"" },
+    { 1, "[^\"]+" },
+};
+
+/// <summary>
+/// Build an automaton from cache_rules.
+/// </summary>
+/// <param name="cache">The cache to build with.</param>
+/// <returns>The automaton.</returns>
+AutomatonCache::Automaton BuildCached(AutomatonCache& cache)
+{
+    return plexiglass::Build<plexiglass::DynamicStorage>(cache_rules, 2, cache);
+}
+
+/// <summary>
+/// Check that two automata are the same.
+/// </summary>
+void CheckSame(const AutomatonCache::Automaton& left,
+               const AutomatonCache::Automaton& right)
+{
+    CHECK(left.Result == plexiglass::Status::Success);
+    CHECK(right.Result == plexiglass::Status::Success);
+    CHECK(left.States == right.States);
+    CHECK(left.Classes == right.Classes);
+    CHECK(std::equal(std::begin(left.ByteClass),
+                     std::end(left.ByteClass),
+                     std::begin(right.ByteClass)));
+    CHECK(left.Next == right.Next);
+    CHECK(left.Accept == right.Accept);
+    CHECK(left.Start == right.Start);
+}
+
+TEST_CASE("Cache: Reuse automata from earlier runs")
+{
+    std::filesystem::path directory = GetTestRoot() / "cache/reuse";
+    std::filesystem::remove_all(directory);
+
+    AutomatonCache cold(directory);
+    auto built = BuildCached(cold);
+    CHECK(cold.Hits() == 0);
+    CHECK(cold.Misses() == 2);
+
+    AutomatonCache warm(directory);
+    auto cached = BuildCached(warm);
+    CHECK(warm.Hits() == 2);
+    CHECK(warm.Misses() == 0);
+
+    plexiglass::NoCache none;
+    CheckSame(built, plexiglass::Build<plexiglass::DynamicStorage>(
+                         cache_rules, 2, none));
+    CheckSame(built, cached);
+}
+
+TEST_CASE("Cache: Rebuild automata from damaged files")
+{
+    std::filesystem::path directory = GetTestRoot() / "cache/damaged";
+    std::filesystem::remove_all(directory);
+
+    AutomatonCache cold(directory);
+    auto built = BuildCached(cold);
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+    {
+        std::filesystem::resize_file(entry.path(),
+                                     std::filesystem::file_size(entry) / 2);
+    }
+
+    AutomatonCache damaged(directory);
+    auto rebuilt = BuildCached(damaged);
+    CHECK(damaged.Hits() == 0);
+    CHECK(damaged.Misses() == 2);
+    CheckSame(built, rebuilt);
+}
+
+TEST_CASE("Cache: Only save automata with a directory")
+{
+    AutomatonCache cache("");
+    auto built = BuildCached(cache);
+    CHECK(cache.Hits() == 0);
+    CHECK(cache.Misses() == 2);
+    CHECK(built.Result == plexiglass::Status::Success);
+}
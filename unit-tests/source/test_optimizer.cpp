@@ -0,0 +1,86 @@
+#include <sstream>
+
+#include "doctest.h"
+
+#include <analyzer/analyzer.hpp>
+#include <optimizer/optimizer.hpp>
+#include <parser/parser.hpp>
+#include <parser/tree.hpp>
+
+#include "test_files.hpp"
+
+/// <summary>
+/// Optimize a lexer and serialize its parse tree to a string.
+/// </summary>
+/// <param name="path">Path to the file to optimize.</param>
+/// <returns>The optimized parse tree, serialized to a string.</returns>
+std::string BuildOptimizedTree(std::filesystem::path path)
+{
+    path = GetTestRoot() / path;
+    FileNode file = Parse(path);
+    Analyze(file);
+    Optimize(file);
+    std::stringstream out;
+    out << file;
+    return out.str();
+}
+
+TEST_CASE("Optimizer: Prune states only reachable from each other")
+{
+    std::string base =
+        ReadTestFile("optimizer/prune-unreachable-cycle-base.txt");
+    std::string out =
+        BuildOptimizedTree("optimizer/prune-unreachable-cycle.txt");
+    CHECK(base == out);
+}
+
+TEST_CASE("Optimizer: Keep the tokens pruned rules produce")
+{
+    FileNode file =
+        Parse(GetTestRoot() / "optimizer/prune-unreachable-cycle.txt");
+    Analyze(file);
+    Optimize(file);
+
+    // B stays a TokenType, even though no remaining rule produces it.
+    std::set<std::string> base = { "A", "B" };
+    CHECK(base == file->prunedTokens);
+}
+
+TEST_CASE("Optimizer: Merge states with identical rules")
+{
+    std::string base =
+        ReadTestFile("optimizer/merge-identical-states-base.txt");
+    std::string out =
+        BuildOptimizedTree("optimizer/merge-identical-states.txt");
+    CHECK(base == out);
+}
+
+TEST_CASE("Optimizer: Merge states that transition to each other")
+{
+    std::string base =
+        ReadTestFile("optimizer/merge-self-transitions-base.txt");
+    std::string out =
+        BuildOptimizedTree("optimizer/merge-self-transitions.txt");
+    CHECK(base == out);
+}
+
+TEST_CASE("Optimizer: Keep states with different transitions apart")
+{
+    std::string base =
+        ReadTestFile("optimizer/no-merge-different-targets-base.txt");
+    std::string out =
+        BuildOptimizedTree("optimizer/no-merge-different-targets.txt");
+    CHECK(base == out);
+}
+
+TEST_CASE("Optimizer: Reachable states")
+{
+    FileNode file =
+        Parse(GetTestRoot() / "optimizer/prune-unreachable-cycle.txt");
+    std::set<std::string> base = { "__initial__" };
+    CHECK(base == GetReachableStates(file));
+
+    file = Parse(GetTestRoot() / "optimizer/no-merge-different-targets.txt");
+    base = { "__initial__", "__jail__", "first", "second" };
+    CHECK(base == GetReachableStates(file));
+}
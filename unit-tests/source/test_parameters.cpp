@@ -44,6 +44,33 @@ TEST_CASE("Parameters: Extra parameters")
     CHECK("" == err.str());
 }
 
+TEST_CASE("Parameters: --incremental without --automaton")
+{
+    std::stringstream out, err, base;
+    std::vector<std::string> params = { "--incremental", "lexer.txt" };
+
+    PrintUsage(base);
+    int result = PlexMain(params, out, err);
+
+    CHECK(bad_usage == result);
+    CHECK(base.str() == out.str());
+    CHECK("" == err.str());
+}
+
+TEST_CASE("Parameters: --cache-dir without a directory")
+{
+    std::stringstream out, err, base;
+    std::vector<std::string> params = { "--automaton", "--cache-dir=",
+                                        "lexer.txt" };
+
+    PrintUsage(base);
+    int result = PlexMain(params, out, err);
+
+    CHECK(bad_usage == result);
+    CHECK(base.str() == out.str());
+    CHECK("" == err.str());
+}
+
 TEST_CASE("Parameters: Nonexistent file")
 {
     std::stringstream out, err;
@@ -0,0 +1,49 @@
+#include <map>
+#include <string>
+
+#include "doctest.h"
+
+#include <error.hpp>
+#include <profile/profile.hpp>
+
+#include "test_files.hpp"
+
+TEST_CASE("Profile: Read rule and state counts")
+{
+    Profile profile = ReadProfile(GetTestRoot() / "profile/valid.txt");
+
+    std::map<size_t, size_t> ruleHits = { { 0, 15 }, { 2, 30 } };
+    std::map<size_t, size_t> stateHits = { { 1, 7 }, { 4, 0 } };
+
+    CHECK(profile.Key == "0123456789abcdef");
+    CHECK(profile.RuleHits == ruleHits);
+    CHECK(profile.StateHits == stateHits);
+}
+
+TEST_CASE("Profile: Reject files that aren't profiles")
+{
+    std::filesystem::path path = GetTestRoot() / "profile/bad-header.txt";
+    std::string message =
+        "Error in profile " + path.string() + ": Not a Plexiglass profile";
+
+    CHECK_THROWS_WITH_AS(ReadProfile(path), message.c_str(), PlexiException);
+}
+
+TEST_CASE("Profile: Reject unknown entries")
+{
+    std::filesystem::path path = GetTestRoot() / "profile/unknown-entry.txt";
+    std::string message =
+        "Error in profile " + path.string() + ": Unknown entry 'expression'";
+
+    CHECK_THROWS_WITH_AS(ReadProfile(path), message.c_str(), PlexiException);
+}
+
+TEST_CASE("Profile: Reject malformed entries")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "profile/malformed-entry.txt";
+    std::string message =
+        "Error in profile " + path.string() + ": Malformed entry";
+
+    CHECK_THROWS_WITH_AS(ReadProfile(path), message.c_str(), PlexiException);
+}
@@ -88,8 +88,97 @@ TEST_CASE("Semantics: Rule that uses rewind")
         GetTestRoot() / "semantics/rule-using-rewind.txt";
     FileNode file = Parse(path);
 
+    CHECK_NOTHROW(Analyze(file));
+}
+
+TEST_CASE("Semantics: Reject rewind without a transition")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-rewind-without-transition.txt";
+    FileNode file = Parse(path);
+
+    CHECK_THROWS_WITH_AS(
+        Analyze(file),
+        "Error on line 6: 'rewind' needs a transition to another state",
+        PlexiException);
+}
+
+TEST_CASE("Semantics: Reject rewind cycles")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-rewind-cycle.txt";
+    FileNode file = Parse(path);
+
+    CHECK_THROWS_WITH_AS(Analyze(file),
+                         "Error on line 11: 'rewind' leads back to state "
+                         "'__initial__' through rules that rewind, so it "
+                         "could rewind forever",
+                         PlexiException);
+}
+
+TEST_CASE("Semantics: Rule that uses intern")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-using-intern.txt";
+    FileNode file = Parse(path);
+
+    CHECK_NOTHROW(Analyze(file));
+}
+
+TEST_CASE("Semantics: Reject intern without a token")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-intern-without-produce.txt";
+    FileNode file = Parse(path);
+
     CHECK_THROWS_WITH_AS(Analyze(file),
-                         "Error on line 6: 'rewind' action not yet supported",
+                         "Error on line 6: 'intern' needs a token to be "
+                         "produced",
+                         PlexiException);
+}
+
+TEST_CASE("Semantics: Reject intern with rewind")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-intern-with-rewind.txt";
+    FileNode file = Parse(path);
+
+    CHECK_THROWS_WITH_AS(Analyze(file),
+                         "Error on line 8: 'intern' can't be used with "
+                         "'rewind'",
+                         PlexiException);
+}
+
+TEST_CASE("Semantics: Rule that uses convert")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-using-convert.txt";
+    FileNode file = Parse(path);
+
+    CHECK_NOTHROW(Analyze(file));
+}
+
+TEST_CASE("Semantics: Reject converting to an unknown type")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-convert-to-unknown.txt";
+    FileNode file = Parse(path);
+
+    CHECK_THROWS_WITH_AS(Analyze(file),
+                         "Error on line 7: Can't convert to 'string', only "
+                         "to integer, float or hex",
+                         PlexiException);
+}
+
+TEST_CASE("Semantics: Reject convert without a token")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-convert-without-produce.txt";
+    FileNode file = Parse(path);
+
+    CHECK_THROWS_WITH_AS(Analyze(file),
+                         "Error on line 6: 'convert' needs a token to be "
+                         "produced",
                          PlexiException);
 }
 
@@ -140,6 +229,18 @@ TEST_CASE("Semantics: Reject duplicate rewind")
         PlexiException);
 }
 
+TEST_CASE("Semantics: Reject duplicate intern")
+{
+    std::filesystem::path path =
+        GetTestRoot() / "semantics/rule-duplicate-intern.txt";
+    FileNode file = Parse(path);
+
+    CHECK_THROWS_WITH_AS(
+        Analyze(file),
+        "Error on line 8: `intern` already used in rule on line 7",
+        PlexiException);
+}
+
 TEST_CASE("Semantics: Reject duplicate transition")
 {
     std::filesystem::path path =
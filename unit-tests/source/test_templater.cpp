@@ -3,13 +3,14 @@
 #include "doctest.h"
 
 #include <analyzer/analyzer.hpp>
+#include <error.hpp>
 #include <parser/parser.hpp>
 #include <parser/tree.hpp>
 #include <templater/templater.hpp>
 
 #include "test_files.hpp"
 
-void TemplaterTest(std::string name, bool debug)
+void TemplaterTest(std::string name, const TemplateOptions& options)
 {
     std::filesystem::path testDir = GetTestRoot() / "template/";
 
@@ -20,7 +21,7 @@ void TemplaterTest(std::string name, bool debug)
 
     FileNode file = Parse(source);
     Analyze(file);
-    Template(file, testName, header, code, debug);
+    Template(file, testName, header, code, options);
 
     std::string base = ReadTestFile("template/" + name + "-base.hpp");
     std::string out = ReadTestFile("template/" + name + "-out.hpp");
@@ -31,6 +32,14 @@ void TemplaterTest(std::string name, bool debug)
     CHECK(base == out);
 }
 
+void TemplaterTest(std::string name, bool debug, bool automaton = false)
+{
+    TemplateOptions options;
+    options.Debug = debug;
+    options.Automaton = automaton;
+    TemplaterTest(name, options);
+}
+
 TEST_CASE("Templater: Test template")
 {
     TemplaterTest("simple", false);
@@ -45,3 +54,133 @@ TEST_CASE("Templater: Test template with all features")
 {
     TemplaterTest("full", true);
 }
+
+TEST_CASE("Templater: Test template with automaton")
+{
+    TemplaterTest("automaton", true, true);
+}
+
+TEST_CASE("Templater: Test automaton read from the cache")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Automaton = true;
+    options.Cache = GetTestRoot() / "template/automaton-cache";
+    std::filesystem::remove_all(options.Cache);
+
+    // The first run fills the cache and the second reads from it. Both
+    // should generate the same lexer.
+    TemplaterTest("automaton", options);
+    TemplaterTest("automaton", options);
+}
+
+TEST_CASE("Templater: Test template with mapped input")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Mmap = true;
+    TemplaterTest("mmap", options);
+}
+
+TEST_CASE("Templater: Test template with a coroutine")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Coroutine = true;
+    TemplaterTest("coroutine", options);
+}
+
+TEST_CASE("Templater: Test template counting lines")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.CountLines = true;
+    TemplaterTest("lines", options);
+}
+
+TEST_CASE("Templater: Test template with lookahead")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Lookahead = 2;
+    TemplaterTest("lookahead", options);
+}
+
+TEST_CASE("Templater: Test template lexing on several threads")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Automaton = true;
+    options.Parallel = true;
+    TemplaterTest("parallel", options);
+}
+
+TEST_CASE("Templater: Test template lexing again after edits")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Automaton = true;
+    options.Incremental = true;
+    TemplaterTest("incremental", options);
+}
+
+TEST_CASE("Templater: Test template with rules that rewind")
+{
+    TemplaterTest("rewind", true);
+    TemplaterTest("rewind_automaton", true, true);
+}
+
+TEST_CASE("Templater: Test template with rules that intern")
+{
+    TemplaterTest("intern", true);
+    TemplaterTest("intern_automaton", true, true);
+}
+
+TEST_CASE("Templater: Test template with rules that convert numbers")
+{
+    TemplaterTest("convert", true);
+    TemplaterTest("convert_automaton", true, true);
+}
+
+TEST_CASE("Templater: Test template laid out by a profile")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Profile = GetTestRoot() / "template/profiled-profile.txt";
+    TemplaterTest("profiled", options);
+}
+
+TEST_CASE("Templater: Test automaton laid out by a profile")
+{
+    TemplateOptions options;
+    options.Debug = true;
+    options.Automaton = true;
+    options.Profile = GetTestRoot() / "template/profiled-profile.txt";
+    TemplaterTest("profiled_automaton", options);
+}
+
+TEST_CASE("Templater: Reject profiles from other lexers")
+{
+    std::filesystem::path testDir = GetTestRoot() / "template/";
+    std::filesystem::path profile = GetTestRoot() / "profile/valid.txt";
+    std::string message = "Error in profile " + profile.string()
+                          + ": Recorded from a different lexer";
+
+    FileNode file = Parse(testDir / "full-in.txt");
+    Analyze(file);
+
+    TemplateOptions options;
+    options.Profile = profile;
+    CHECK_THROWS_WITH_AS(Template(file,
+                                  "full",
+                                  testDir / "rejected-out.hpp",
+                                  testDir / "rejected-out.cpp",
+                                  options),
+                         message.c_str(),
+                         PlexiException);
+}
+
+TEST_CASE("Templater: Test automaton with lazy quantifiers")
+{
+    TemplaterTest("lazy", false, true);
+}
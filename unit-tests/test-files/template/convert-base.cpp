@@ -0,0 +1,1382 @@
+#include "convert.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+std::string ReadFile(const std::filesystem::path& path);
+
+enum class LexerState
+{
+    __initial__,
+    __jail__,
+};
+
+// What a rule's convert action turns the text it matched into, if anything.
+enum class Conversion
+{
+    None,
+    Integer,
+    Float,
+    Hex
+};
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/// <summary>
+/// Convert a number's text to its value, without allocating or looking at the
+/// locale. Numbers too big to represent are clamped to the largest there is,
+/// and floats too small become 0, as strtoll() and strtod() do. Anything after
+/// the number, like a suffix, is ignored.
+/// </summary>
+/// <param name="text">The number's text.</param>
+/// <param name="convert">How to read it.</param>
+/// <param name="integer">Set to its value, unless it's a float.</param>
+/// <param name="real">Set to its value as a float.</param>
+void ConvertNumber(std::string_view text,
+                   Conversion convert,
+                   int64_t& integer,
+                   double& real)
+{
+    const char* first = text.data();
+    const char* last = text.data() + text.size();
+    bool negative = first != last && *first == '-';
+
+    if (convert == Conversion::Float)
+    {
+        std::from_chars_result result = std::from_chars(first, last, real);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            const char* exponent = std::find_if(first, last, [](char c) {
+                return c == 'e' || c == 'E';
+            });
+            bool tiny = exponent != last && exponent + 1 != last
+                        && exponent[1] == '-';
+            real = tiny ? 0 : HUGE_VAL;
+            real = negative ? -real : real;
+        }
+    }
+    else if (convert == Conversion::Hex)
+    {
+        // Hex numbers are read as 64 unsigned bits, so any bit pattern fits.
+        if (last - first > 2 && first[0] == '0'
+            && (first[1] == 'x' || first[1] == 'X'))
+        {
+            first += 2;
+        }
+
+        uint64_t bits = 0;
+        std::from_chars_result result = std::from_chars(first, last, bits, 16);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            bits = std::numeric_limits<uint64_t>::max();
+        }
+        integer = static_cast<int64_t>(bits);
+        real = static_cast<double>(bits);
+    }
+    else
+    {
+        std::from_chars_result result = std::from_chars(first, last, integer);
+        if (result.ec == std::errc::result_out_of_range)
+        {
+            integer = negative ? std::numeric_limits<int64_t>::min()
+                               : std::numeric_limits<int64_t>::max();
+        }
+        real = static_cast<double>(integer);
+    }
+}
+
+/// <summary>
+/// Get a human-readable string representation of a token.
+/// </summary>
+/// <param name="type">The token's type.</param>
+/// <param name="text">The token's text.</param>
+/// <returns>String representation of the token.</returns>
+std::string ToString(TokenType type, std::string_view text)
+{
+    std::string str;
+    switch (type)
+    {
+    case TokenType::__eof__:
+        str = "__eof__";
+        break;
+    case TokenType::__jam__:
+        str = "__jam__";
+        break;
+    case TokenType::__nothing__:
+        str = "__nothing__";
+        break;
+    case TokenType::floatToken:
+        str = "floatToken";
+        break;
+    case TokenType::hexToken:
+        str = "hexToken";
+        break;
+    case TokenType::integerToken:
+        str = "integerToken";
+        break;
+    default:
+            throw std::exception("Unrecognized token type in ToString()");
+    }
+
+    if (!text.empty())
+    {
+        str += " ";
+        str += text;
+    }
+
+    return str;
+}
+
+/// <summary>
+/// Hash some text eight bytes at a time.
+/// </summary>
+/// <param name="text">The text.</param>
+/// <returns>The text's hash.</returns>
+size_t HashText(std::string_view text)
+{
+    constexpr uint64_t multiplier = 0x9E3779B97F4A7C15;
+    uint64_t hash = text.size() * multiplier;
+    size_t index = 0;
+
+    for (; index + 8 <= text.size(); index += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, text.data() + index, 8);
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t word = 0;
+    std::memcpy(&word, text.data() + index, text.size() - index);
+    hash = (hash ^ word) * multiplier;
+    hash ^= hash >> 32;
+
+    return static_cast<size_t>(hash);
+}
+
+/// <summary>
+/// Get the symbol for some text, interning it if it hasn't been already.
+/// </summary>
+/// <param name="text">The text.</param>
+/// <returns>
+/// The text's symbol. Symbols count up from 0 in the order texts were first
+/// interned.
+/// </returns>
+size_t SymbolTable::Intern(std::string_view text)
+{
+    if (m_entries.size() * 2 >= m_slots.size())
+    {
+        Grow();
+    }
+
+    size_t hash = HashText(text);
+    size_t mask = m_slots.size() - 1;
+    size_t slot = hash & mask;
+    for (; m_slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        size_t symbol = m_slots[slot] - 1;
+        if (m_entries[symbol].Hash == hash && Text(symbol) == text)
+        {
+            return symbol;
+        }
+    }
+
+    // Copy the text to the end of the last block, or into a new one if it
+    // won't fit. Blocks are never resized, so texts already copied stay put.
+    constexpr size_t block_size = 65536;
+    if (m_blocks.empty()
+        || m_blocks.back().capacity() - m_blocks.back().size() < text.size())
+    {
+        m_blocks.emplace_back().reserve(std::max(block_size, text.size()));
+    }
+    std::vector<char>& block = m_blocks.back();
+    m_entries.push_back({ m_blocks.size() - 1, block.size(), text.size(),
+                          hash });
+    block.insert(block.end(), text.begin(), text.end());
+
+    m_slots[slot] = m_entries.size();
+    return m_entries.size() - 1;
+}
+
+/// <summary>
+/// Get the text a symbol stands for.
+/// </summary>
+/// <param name="symbol">The symbol.</param>
+/// <returns>
+/// The symbol's text, which stays valid for as long as the table does.
+/// </returns>
+std::string_view SymbolTable::Text(size_t symbol) const
+{
+    const Entry& entry = m_entries[symbol];
+    return std::string_view(m_blocks[entry.Block].data() + entry.Offset,
+                            entry.Length);
+}
+
+/// <summary>
+/// Get how many symbols there are.
+/// </summary>
+/// <returns>How many symbols there are, one more than the largest.</returns>
+size_t SymbolTable::Size() const
+{
+    return m_entries.size();
+}
+
+/// <summary>
+/// Double the number of slots, and put every symbol back in them.
+/// </summary>
+void SymbolTable::Grow()
+{
+    m_slots.assign(std::max<size_t>(m_slots.size() * 2, 64), 0);
+    size_t mask = m_slots.size() - 1;
+
+    for (size_t symbol = 0; symbol < m_entries.size(); symbol++)
+    {
+        size_t slot = m_entries[symbol].Hash & mask;
+        while (m_slots[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = symbol + 1;
+    }
+}
+
+/// <summary>
+/// Construct convert to lex input fed to it a piece at a time with Feed().
+/// </summary>
+/// <param name="maxTokenLength">The length of the longest token.</param>
+convert::convert(size_t maxTokenLength)
+    : m_state(LexerState::__initial__)
+    , m_line(1)
+    , m_type(TokenType::__nothing__)
+    , m_length(0)
+    , m_maxTokenLength(maxTokenLength)
+    , m_more(true)
+{
+    m_view = m_reference;
+}
+
+/// <summary>
+/// Construct convert to lex text it doesn't own. Nothing is copied, so
+/// the text must outlive the lexer and the text of its tokens.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+convert::convert(TextInput, std::string_view input)
+    : m_view(input)
+    , m_state(LexerState::__initial__)
+    , m_line(1)
+{
+    Shift();
+}
+
+/// <summary>
+/// Construct convert to lex text it takes ownership of.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+convert::convert(TextInput, std::string&& input)
+    : m_reference(std::move(input))
+    , m_view(m_reference)
+    , m_state(LexerState::__initial__)
+    , m_line(1)
+{
+    Shift();
+}
+
+/// <summary>
+/// Make a convert to lex text it doesn't own. Nothing is copied, so the
+/// text must outlive the lexer and the text of its tokens.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+convert convert::FromText(std::string_view input)
+{
+    return convert(TextInput(), input);
+}
+
+/// <summary>
+/// Make a convert to lex a string literal, or other text it doesn't own.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+convert convert::FromText(const char* input)
+{
+    return convert(TextInput(), std::string_view(input));
+}
+
+/// <summary>
+/// Make a convert to lex text it takes ownership of.
+/// </summary>
+/// <param name="input">The text to lex.</param>
+convert convert::FromText(std::string&& input)
+{
+    return convert(TextInput(), std::move(input));
+}
+
+/// <summary>
+/// Construct convert to lex a stream a chunk at a time.
+/// </summary>
+/// <param name="input">The stream to lex.</param>
+/// <param name="chunkSize">How much to read from the stream at once.</param>
+/// <param name="maxTokenLength">The length of the longest token.</param>
+convert::convert(std::istream& input,
+                         size_t chunkSize,
+                         size_t maxTokenLength)
+    : convert(
+        [&input](char* data, size_t size) {
+            input.read(data, static_cast<std::streamsize>(size));
+            return static_cast<size_t>(input.gcount());
+        },
+        chunkSize,
+        maxTokenLength)
+{
+}
+
+/// <summary>
+/// Construct convert to lex input read a chunk at a time. Only one chunk
+/// and one token's worth of input are kept in memory.
+/// </summary>
+/// <param name="read">
+/// Reads up to the given number of bytes into the given buffer, and returns
+/// how many were read, or 0 at the end of the input.
+/// </param>
+/// <param name="chunkSize">How much to read at once.</param>
+/// <param name="maxTokenLength">The length of the longest token.</param>
+convert::convert(std::function<size_t(char*, size_t)> read,
+                         size_t chunkSize,
+                         size_t maxTokenLength)
+    : m_state(LexerState::__initial__)
+    , m_line(1)
+    , m_read(std::move(read))
+    , m_chunkSize(chunkSize)
+    , m_maxTokenLength(maxTokenLength)
+{
+    m_reference.reserve(chunkSize + maxTokenLength + 1);
+    m_view = m_reference;
+    Shift();
+}
+
+/// <summary>
+/// Retrieve the line the next token starts on.
+/// </summary>
+/// <returns>The line the next token starts on.</returns>
+size_t convert::PeekLine() const
+{
+    return m_tokens[m_first].Line;
+}
+
+/// <summary>
+/// Retrieve how far into the input the next token starts.
+/// </summary>
+/// <returns>The next token's offset, in bytes.</returns>
+size_t convert::PeekOffset() const
+{
+    return m_tokens[m_first].Offset;
+}
+
+/// <summary>
+/// Retrieve the column the next token starts at.
+/// </summary>
+/// <returns>
+/// The next token's column, counted in bytes from 1 at the start of its line.
+/// </returns>
+size_t convert::PeekColumn() const
+{
+    return m_tokens[m_first].Column;
+}
+
+/// <summary>
+/// Retrieve the next TokenType without removing it.
+/// </summary>
+/// <returns>
+/// The next TokenType, or __nothing__ if input being fed ran out first.
+/// </returns>
+TokenType convert::PeekToken() const
+{
+    return m_count > 0 ? m_tokens[m_first].Type : TokenType::__nothing__;
+}
+
+/// <summary>
+/// Retrieve the next token's text without removing it.
+/// </summary>
+/// <returns>
+/// The next token's text. It points into the lexer's input, so it stays valid
+/// for as long as the lexer does, or until the next Shift() when streaming.
+/// </returns>
+std::string_view convert::PeekText() const
+{
+    if (m_count == 0)
+    {
+        return std::string_view();
+    }
+
+    const Lexed& token = m_tokens[m_first];
+    return std::string_view(m_view.data() - (m_offset - token.Offset),
+                            token.Length);
+}
+
+/// <summary>
+/// Retrieve the next token's symbol without removing it.
+/// </summary>
+/// <returns>
+/// The next token's symbol in Symbols(), or no_symbol if its rule doesn't
+/// intern it.
+/// </returns>
+size_t convert::PeekSymbol() const
+{
+    return m_count > 0 ? m_tokens[m_first].Symbol : no_symbol;
+}
+
+/// <summary>
+/// Retrieve the next token's value as an integer, without removing it.
+/// </summary>
+/// <returns>
+/// The value of the next token, if its rule converts it to an integer or from
+/// hex, or 0 if not.
+/// </returns>
+int64_t convert::PeekInteger() const
+{
+    return m_count > 0 ? m_tokens[m_first].Integer : 0;
+}
+
+/// <summary>
+/// Retrieve the next token's value as a float, without removing it.
+/// </summary>
+/// <returns>
+/// The value of the next token, if its rule converts it to anything, or 0 if
+/// not.
+/// </returns>
+double convert::PeekFloat() const
+{
+    return m_count > 0 ? m_tokens[m_first].Float : 0;
+}
+
+/// <summary>
+/// Retrieve the TokenType of a token after the next one, lexing as far ahead
+/// as needed. Tokens lexed ahead aren't lexed again when they're reached.
+/// </summary>
+/// <param name="ahead">
+/// How many tokens past the next one to look, up to lookahead.
+/// </param>
+/// <returns>
+/// The token's TokenType, or __nothing__ if input being fed ran out first.
+/// </returns>
+TokenType convert::PeekToken(size_t ahead)
+{
+    if (ahead > lookahead)
+    {
+        throw std::exception("convert::PeekToken(): Can't look that far "
+                             "ahead.");
+    }
+
+    while (m_count <= ahead)
+    {
+        if (!LexAhead())
+        {
+            return TokenType::__nothing__;
+        }
+    }
+
+    return m_tokens[(m_first + ahead) % m_tokens.size()].Type;
+}
+
+/// <summary>
+/// Retrieve the text of a token after the next one, lexing as far ahead as
+/// needed.
+/// </summary>
+/// <param name="ahead">
+/// How many tokens past the next one to look, up to lookahead.
+/// </param>
+/// <returns>
+/// The token's text, or nothing if input being fed ran out first. It stays
+/// valid as long as the next token's text does.
+/// </returns>
+std::string_view convert::PeekText(size_t ahead)
+{
+    if (PeekToken(ahead) == TokenType::__nothing__)
+    {
+        return std::string_view();
+    }
+
+    const Lexed& token = m_tokens[(m_first + ahead) % m_tokens.size()];
+    return std::string_view(m_view.data() - (m_offset - token.Offset),
+                            token.Length);
+}
+
+/// <summary>
+/// Retrieve the symbol of a token after the next one, lexing as far ahead as
+/// needed.
+/// </summary>
+/// <param name="ahead">
+/// How many tokens past the next one to look, up to lookahead.
+/// </param>
+/// <returns>
+/// The token's symbol, or no_symbol if its rule doesn't intern it or input
+/// being fed ran out first.
+/// </returns>
+size_t convert::PeekSymbol(size_t ahead)
+{
+    if (PeekToken(ahead) == TokenType::__nothing__)
+    {
+        return no_symbol;
+    }
+
+    return m_tokens[(m_first + ahead) % m_tokens.size()].Symbol;
+}
+
+/// <summary>
+/// Get the text interned so far, to look symbols up in.
+/// </summary>
+/// <returns>The lexer's symbol table.</returns>
+const SymbolTable& convert::Symbols() const
+{
+    return m_symbols;
+}
+
+#if 0
+/// <summary>
+/// Count the newlines in some text, eight bytes at a time.
+/// </summary>
+/// <param name="text">The text.</param>
+/// <returns>How many newlines there are.</returns>
+size_t CountNewlines(std::string_view text)
+{
+    constexpr uint64_t ones = 0x0101010101010101;
+    constexpr uint64_t lows = 0x7F7F7F7F7F7F7F7F;
+    constexpr uint64_t newlines = ones * '\n';
+
+    size_t count = 0;
+    size_t index = 0;
+    for (; index + 8 <= text.size(); index += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, text.data() + index, 8);
+
+        // Newlines become zero bytes, then only zero bytes get their high bit
+        // set. Multiplying adds those bits up in the top byte.
+        word ^= newlines;
+        uint64_t zeros = ~(((word & lows) + lows) | word | lows);
+        count += static_cast<size_t>(((zeros >> 7) * ones) >> 56);
+    }
+
+    for (; index < text.size(); index++)
+    {
+        count += text[index] == '\n';
+    }
+
+    return count;
+}
+#endif
+
+/// <summary>
+/// Advance the lexer to the next token. When input is being fed, the next
+/// token is __nothing__ if more input is needed to finish it.
+/// </summary>
+void convert::Shift()
+{
+    if (m_count > 0)
+    {
+        m_first = (m_first + 1) % m_tokens.size();
+        m_count--;
+    }
+
+    if (m_count == 0)
+    {
+        LexAhead();
+    }
+}
+
+/// <summary>
+/// Lex the token after the last one lexed, adding it to the tokens waiting to
+/// be shifted past.
+/// </summary>
+/// <returns>
+/// Whether there was a complete token. If not, more input has to be fed first.
+/// </returns>
+bool convert::LexAhead()
+{
+    m_type = TokenType::__nothing__;
+    size_t column = 0;
+    while (m_type == TokenType::__nothing__)
+    {
+        m_intern = false;
+        m_convert = Conversion::None;
+        Refill();
+        if (!ShiftHelper())
+        {
+            return false;
+        }
+
+        std::string_view text(m_view.data() - m_length, m_length);
+#if 0
+        m_line += CountNewlines(text);
+#endif
+
+        // Columns count bytes from just after the last newline before the
+        // token, which can only have moved if the token has newlines in it.
+        column = m_offset - m_lineStart + 1;
+        size_t newline = text.rfind('\n');
+        if (newline != std::string_view::npos)
+        {
+            m_lineStart = m_offset + newline + 1;
+        }
+        m_offset += m_length;
+
+        // There was more input than the longest token, so a token that used
+        // all of it could have continued past what was read.
+        if (m_read && m_view.empty())
+        {
+            throw std::exception("convert::Shift(): Token longer than "
+                                 "the maximum token length.");
+        }
+
+        if (m_skipped[static_cast<size_t>(m_type)])
+        {
+            m_type = TokenType::__nothing__;
+        }
+    }
+
+    // Text is interned and converted while it's still in cache from being
+    // matched.
+    std::string_view text(m_view.data() - m_length, m_length);
+    size_t symbol = m_intern ? m_symbols.Intern(text) : no_symbol;
+    int64_t integer = 0;
+    double real = 0;
+#if 1
+    if (m_convert != Conversion::None)
+    {
+        ConvertNumber(text, m_convert, integer, real);
+    }
+#endif
+
+    m_tokens[(m_first + m_count) % m_tokens.size()] = {
+        m_type, m_offset - m_length, m_length, m_line, column, symbol, integer,
+        real
+    };
+    m_count++;
+    return true;
+}
+
+/// <summary>
+/// Get how much of the input before m_view is still needed, for the text of
+/// tokens that haven't been shifted past.
+/// </summary>
+/// <returns>How many bytes before m_view are still needed.</returns>
+size_t convert::Unshifted() const
+{
+    return m_count > 0 ? m_offset - m_tokens[m_first].Offset : 0;
+}
+
+/// <summary>
+/// Give the lexer more input. Text from tokens already shifted past is no
+/// longer valid afterwards, since only the input still needed is kept.
+/// </summary>
+/// <param name="input">
+/// The input. It's copied, so it needn't outlive the call.
+/// </param>
+void convert::Feed(std::string_view input)
+{
+    size_t keep = Unshifted();
+    m_reference.erase(0, m_reference.size() - m_view.size() - keep);
+    m_reference.append(input);
+    m_view = std::string_view(m_reference).substr(keep);
+}
+
+/// <summary>
+/// Advance to the next token of the input fed so far.
+/// </summary>
+/// <returns>
+/// Whether there was a complete token. If not, more input must be fed, or the
+/// input finished, first.
+/// </returns>
+bool convert::Next()
+{
+    Shift();
+    return m_count > 0;
+}
+
+/// <summary>
+/// Mark the end of the input fed to the lexer. Next() then lexes whatever is
+/// left, followed by __eof__.
+/// </summary>
+void convert::Finish()
+{
+    m_more = false;
+}
+
+/// <summary>
+/// Lex up to count tokens into arrays, starting with the next token, without
+/// returning between tokens. The lexer is left on the token after the last
+/// one written. Writing stops early after __eof__, or when input being fed
+/// runs out.
+/// </summary>
+/// <param name="batch">The arrays to write tokens into.</param>
+/// <param name="count">How many tokens the arrays have room for.</param>
+/// <returns>How many tokens were written.</returns>
+size_t convert::LexBatch(const TokenBatch& batch, size_t count)
+{
+    // A lexer being fed input that ran out is waiting to lex its next token.
+    if (m_count == 0)
+    {
+        Shift();
+    }
+
+    size_t written = 0;
+    while (written < count && m_count > 0)
+    {
+        const Lexed& token = m_tokens[m_first];
+        if (batch.Types)
+        {
+            batch.Types[written] = token.Type;
+        }
+        if (batch.Offsets)
+        {
+            batch.Offsets[written] = token.Offset;
+        }
+        if (batch.Lengths)
+        {
+            batch.Lengths[written] = token.Length;
+        }
+        if (batch.Lines)
+        {
+            batch.Lines[written] = token.Line;
+        }
+        if (batch.Columns)
+        {
+            batch.Columns[written] = token.Column;
+        }
+        if (batch.Symbols)
+        {
+            batch.Symbols[written] = token.Symbol;
+        }
+        if (batch.Integers)
+        {
+            batch.Integers[written] = token.Integer;
+        }
+        if (batch.Floats)
+        {
+            batch.Floats[written] = token.Float;
+        }
+        written++;
+
+        if (token.Type == TokenType::__eof__)
+        {
+            break;
+        }
+        Shift();
+    }
+
+    return written;
+}
+
+/// <summary>
+/// Choose which tokens the lexer produces. The rest are skipped as they're
+/// lexed, as if their rules produced nothing, so they never reach
+/// PeekToken(), iterators or LexBatch(). __eof__ is always produced.
+/// Tokens already lexed ahead that aren't wanted are dropped.
+/// </summary>
+/// <param name="wanted">The TokenTypes to produce.</param>
+void convert::Filter(const TokenFilter& wanted)
+{
+    m_skipped = ~wanted;
+    m_skipped.reset(static_cast<size_t>(TokenType::__eof__));
+
+    size_t kept = 0;
+    for (size_t index = 0; index < m_count; index++)
+    {
+        Lexed token = m_tokens[(m_first + index) % m_tokens.size()];
+        if (!m_skipped[static_cast<size_t>(token.Type)])
+        {
+            m_tokens[(m_first + kept) % m_tokens.size()] = token;
+            kept++;
+        }
+    }
+
+    // If every token lexed ahead was dropped, lex the next wanted one.
+    bool lexedAhead = m_count > 0;
+    m_count = kept;
+    if (lexedAhead && m_count == 0)
+    {
+        LexAhead();
+    }
+}
+
+/// <summary>
+/// Save where the lexer is, to go back to later with Restore().
+/// </summary>
+/// <returns>The checkpoint.</returns>
+convert::Checkpoint convert::Save() const
+{
+    Checkpoint checkpoint{};
+    checkpoint.Tokens = m_tokens;
+    checkpoint.First = m_first;
+    checkpoint.Count = m_count;
+    checkpoint.Offset = m_offset;
+    checkpoint.State = m_state;
+    checkpoint.Line = m_line;
+    checkpoint.LineStart = m_lineStart;
+#if 0
+    checkpoint.Scan = m_scan;
+#endif
+#if 0
+    checkpoint.Reach = m_reach;
+#endif
+    return checkpoint;
+}
+
+/// <summary>
+/// Go back, or forward, to where the lexer was when a checkpoint was saved.
+/// Nothing is lexed again until the lexer passes the tokens it had lexed
+/// then.
+/// </summary>
+/// <param name="checkpoint">A checkpoint saved from this lexer.</param>
+void convert::Restore(const Checkpoint& checkpoint)
+{
+    // Streamed and fed input is thrown away once it's been lexed.
+    if (m_maxTokenLength > 0)
+    {
+        throw std::exception("convert::Restore(): Can't restore a lexer "
+                             "whose input is streamed or fed.");
+    }
+
+    const char* end = m_view.data() + m_view.size();
+    const char* cursor = m_view.data()
+                         + (static_cast<std::ptrdiff_t>(checkpoint.Offset)
+                            - static_cast<std::ptrdiff_t>(m_offset));
+    m_view = std::string_view(cursor, static_cast<size_t>(end - cursor));
+
+    m_tokens = checkpoint.Tokens;
+    m_first = checkpoint.First;
+    m_count = checkpoint.Count;
+    m_offset = checkpoint.Offset;
+    m_state = checkpoint.State;
+    m_line = checkpoint.Line;
+    m_lineStart = checkpoint.LineStart;
+#if 0
+    m_scan = checkpoint.Scan;
+#endif
+#if 0
+    m_reach = checkpoint.Reach;
+#endif
+}
+
+/// <summary>
+/// When streaming, make sure there's more input left than the longest token,
+/// unless the input has run out.
+/// </summary>
+void convert::Refill()
+{
+    if (!m_read || m_view.size() > m_maxTokenLength)
+    {
+        return;
+    }
+
+    // Everything before the tokens not yet shifted past has been lexed, so it
+    // can go. Unless tokens have been lexed ahead, the buffer is never resized
+    // past what the constructor reserved.
+    size_t keep = Unshifted();
+    m_reference.erase(0, m_reference.size() - m_view.size() - keep);
+
+    size_t size = m_reference.size();
+    m_reference.resize(keep + m_chunkSize + m_maxTokenLength + 1);
+    while (m_read && size - keep <= m_maxTokenLength)
+    {
+        size_t read =
+            m_read(m_reference.data() + size, m_reference.size() - size);
+        if (read == 0)
+        {
+            m_read = nullptr;
+        }
+        size += read;
+    }
+    m_reference.resize(size);
+
+    m_view = std::string_view(m_reference).substr(keep);
+}
+
+#include <array>
+#include <regex>
+#include <vector>
+
+// The tables below are shared by every lexer and never change once the
+// program has started. All a lexer changes while it lexes lives in the lexer
+// object itself, so any number of lexers may run on separate threads at once.
+
+struct Rule
+{
+    LexerState Active;     // the state the rule is active in
+    const char* Pattern;   // a regular expression describing what it matches
+    LexerState Transition; // the state the rule transitions to
+    TokenType Token;       // the TokenType produced
+    int Increment;         // how much to change the current line number by
+    bool Rewind;           // whether the matched text is lexed again
+    bool Intern;           // whether the matched text is interned
+    Conversion Convert;    // what the matched text is converted to
+    size_t Priority;       // index in the lexer description; lower wins ties
+};
+
+/// <summary>
+/// Get the rules to be used by the lexer.
+/// </summary>
+/// <returns>The rules to be used by the lexer.</returns>
+constexpr std::array<Rule, 4> GetRules()
+{
+    constexpr char* hex_number = "0[xX][0-9a-fA-F]+";
+    constexpr char* float_number = "[0-9]+\\.[0-9]*([eE][-+]?[0-9]+)?";
+    constexpr char* integer_number = "[0-9]+";
+    constexpr char* white = "[ \\t\\n]+";
+
+    return { {
+        { LexerState::__initial__, hex_number, LexerState::__initial__, TokenType::hexToken, 0, false, false, Conversion::Hex, 0 },
+        { LexerState::__initial__, float_number, LexerState::__initial__, TokenType::floatToken, 0, false, false, Conversion::Float, 1 },
+        { LexerState::__initial__, integer_number, LexerState::__initial__, TokenType::integerToken, 0, false, false, Conversion::Integer, 2 },
+        { LexerState::__initial__, white, LexerState::__initial__, TokenType::__nothing__, 0, false, false, Conversion::None, 3 },
+    } };
+}
+
+// The rules, built while compiling so no lexer has to build them first.
+constexpr std::array<Rule, 4> rules = GetRules();
+
+/// <summary>
+/// Compile the rules' patterns.
+/// </summary>
+/// <returns>The compiled patterns, in the same order as the rules.</returns>
+std::vector<std::regex> CompilePatterns()
+{
+    std::vector<std::regex> patterns;
+    patterns.reserve(rules.size());
+    for (const Rule& rule : rules)
+    {
+        patterns.emplace_back(rule.Pattern);
+    }
+    return patterns;
+}
+
+/// <summary>
+/// Get the rules' compiled patterns. A std::regex can't be built while
+/// compiling, so they're compiled the first time a lexer is constructed, which
+/// the function-local static makes thread-safe. They're only read after that,
+/// and matching with a const std::regex is safe from any number of threads.
+/// </summary>
+/// <returns>The compiled patterns, in the same order as the rules.</returns>
+const std::vector<std::regex>& convert::Patterns()
+{
+    static const std::vector<std::regex> patterns = CompilePatterns();
+    return patterns;
+}
+
+#if 1
+// How many times each rule matched on this thread, by its index in the lexer
+// description.
+thread_local size_t rule_hits[4] = {};
+
+/// <summary>
+/// Write how many times each rule matched to a profile.
+/// </summary>
+/// <param name="out">The profile.</param>
+void WriteProfile(std::ostream& out)
+{
+    for (size_t rule = 0; rule < 4; rule++)
+    {
+        out << "rule " << rule << " " << rule_hits[rule] << "\n";
+    }
+}
+#endif
+
+/// <summary>
+/// Helper function for convert::Shift().
+/// </summary>
+/// <returns>
+/// Whether a token was found. If not, more input has to be fed first.
+/// </returns>
+bool convert::ShiftHelper()
+{
+    // A regex can't be paused when fed input runs out, so tokens are only
+    // matched once there's more input than the longest token, or no more to
+    // come.
+    if (m_more && m_view.size() <= m_maxTokenLength)
+    {
+        return false;
+    }
+
+    if (m_view.empty())
+    {
+        m_type = TokenType::__eof__;
+        m_length = 0;
+        return true;
+    }
+
+    using vmatch = std::match_results<std::string_view::const_iterator>;
+
+    size_t max_index = 0;
+    size_t max_length = 0;
+    size_t max_priority = 0;
+
+    const std::vector<std::regex>& patterns = *m_patterns;
+    for (size_t index = 0; index < rules.size(); index++)
+    {
+        const Rule& rule = rules[index];
+
+        if (rule.Active != m_state)
+        {
+            continue;
+        }
+
+        vmatch m;
+        bool matched = std::regex_search(
+            m_view.begin(), m_view.end(), m, patterns[index]);
+        if (!matched || m.position() != 0)
+        {
+            continue;
+        }
+
+        // Ensure following cast is safe
+        if (m.length() < 0)
+        {
+            throw std::exception("convert::Shift(): Length was negative.");
+        }
+        size_t length = static_cast<size_t>(std::abs(m.length()));
+
+        // Rules may be ordered by how often they match rather than how they
+        // were described, so ties go to the rule described first.
+        if (length > max_length
+            || (length == max_length && rule.Priority < max_priority))
+        {
+            max_length = length;
+            max_index = index;
+            max_priority = rule.Priority;
+        }
+    }
+
+    if (m_more && max_length == m_view.size())
+    {
+        throw std::exception("convert::Shift(): Token longer than the "
+                             "maximum token length.");
+    }
+
+    if (max_length > 0)
+    {
+#if 1
+        rule_hits[max_priority]++;
+#endif
+        // A rule that rewinds leaves its text to be lexed again.
+        m_type = rules[max_index].Token;
+        m_length = rules[max_index].Rewind ? 0 : max_length;
+        m_intern = rules[max_index].Intern;
+        m_convert = rules[max_index].Convert;
+        m_view.remove_prefix(m_length);
+#if !0
+        m_line += rules[max_index].Increment;
+#endif
+        m_state = rules[max_index].Transition;
+        return true;
+    }
+    else
+    {
+        m_type = TokenType::__jam__;
+        m_length = 1;
+        m_view.remove_prefix(1);
+        return true;
+    }
+}
+
+/// <summary>
+/// Read the contents of a file in as a string.
+/// </summary>
+/// <param name="path">Path to the file to read the contents of.</param>
+/// <returns>The contents of the file.</returns>
+std::string ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream in(path);
+    std::string data;
+
+    if (!in)
+    {
+        throw std::exception("ReadFile(): Unable to open the input file.");
+    }
+
+    // Pipes and other special files have no size to reserve up front.
+    if (std::filesystem::is_regular_file(path))
+    {
+        data.reserve(std::filesystem::file_size(path));
+    }
+    data.assign(std::istreambuf_iterator<char>(in),
+                std::istreambuf_iterator<char>());
+
+    return data;
+}
+
+/// <summary>
+/// Construct convert to lex a file.
+/// </summary>
+/// <param name="path">Path to the file to lex.</param>
+convert::convert(const std::filesystem::path& path)
+    : convert(TextInput(), ReadFile(path))
+{
+}
+
+#if 1 // Used to include/exclude driver code. Filled in by templater.
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Runs the lexer, writing all the tokens it generates to an output file.
+/// </summary>
+/// <param name="inputPath">Path to file to lex.</param>
+/// <param name="outputPath">Path to output file.</param>
+/// <returns>How many tokens were written, including the end of file.</returns>
+size_t RunLexer(const std::filesystem::path& inputPath,
+                const std::filesystem::path& outputPath)
+{
+    convert lex(inputPath);
+
+    std::ofstream out(outputPath);
+    size_t tokens = 1;
+
+    while (lex.PeekToken() != TokenType::__eof__)
+    {
+        out << lex.PeekLine() << ": "
+            << ToString(lex.PeekToken(), lex.PeekText()) << "\n";
+        lex.Shift();
+        tokens++;
+    }
+
+    out << lex.PeekLine() << ": " << ToString(lex.PeekToken(), lex.PeekText())
+        << "\n";
+    return tokens;
+}
+
+struct BatchJob
+{
+    std::filesystem::path Input;  // file to lex
+    std::filesystem::path Output; // where its tokens go
+    uintmax_t Size = 0;           // input's size in bytes
+    size_t Tokens = 0;            // how many tokens it had
+    std::string Error;            // why it couldn't be lexed, if it couldn't
+};
+
+/// <summary>
+/// Get where a file's tokens go under a batch's output directory. The file's
+/// whole path is mirrored there, minus any root and any "..", so files with
+/// the same name in different directories don't overwrite each other.
+/// </summary>
+/// <param name="outputDir">Directory to write tokens to.</param>
+/// <param name="input">File to lex.</param>
+/// <returns>Path to write the file's tokens to.</returns>
+std::filesystem::path BatchOutput(const std::filesystem::path& outputDir,
+                                  const std::filesystem::path& input)
+{
+    std::filesystem::path output = outputDir;
+    for (const auto& part : input.lexically_normal().relative_path())
+    {
+        if (part != ".." && part != ".")
+        {
+            output /= part;
+        }
+    }
+    return output;
+}
+
+/// <summary>
+/// Runs the lexer over many files on one thread per processor, writing each
+/// file's tokens under an output directory, at the same path the file was
+/// given by or found at.
+///
+/// The threads share a single list of files, largest first, and an atomic
+/// index into it. Each thread takes the next file whenever it finishes one,
+/// so no thread sits idle while there are files left to lex. Files that
+/// can't be found, read or written are reported and the rest are still lexed.
+/// </summary>
+/// <param name="outputDir">Directory to write tokens to.</param>
+/// <param name="inputs">Files and directories to lex.</param>
+/// <returns>Whether every file was lexed.</returns>
+bool RunBatch(const std::filesystem::path& outputDir,
+              const std::vector<std::filesystem::path>& inputs)
+{
+    namespace fs = std::filesystem;
+    std::vector<BatchJob> jobs;
+
+    for (const fs::path& input : inputs)
+    {
+        // A directory that can't be walked any further keeps the files found
+        // in it so far.
+        try
+        {
+            if (!fs::is_directory(input))
+            {
+                jobs.push_back(
+                    { input, BatchOutput(outputDir, input), 0, 0, {} });
+                continue;
+            }
+
+            for (const auto& entry : fs::recursive_directory_iterator(
+                     input, fs::directory_options::skip_permission_denied))
+            {
+                if (entry.is_regular_file())
+                {
+                    fs::path output = BatchOutput(outputDir, entry.path());
+                    jobs.push_back({ entry.path(), output, 0, 0, {} });
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            jobs.push_back({ input, {}, 0, 0, e.what() });
+        }
+    }
+
+    // Paths that only differ by a root or ".." could still end up at the same
+    // output, and a file given twice would be lexed twice.
+    std::map<fs::path, size_t> outputs;
+    for (size_t index = 0; index < jobs.size(); index++)
+    {
+        BatchJob& job = jobs[index];
+        if (!job.Error.empty())
+        {
+            continue;
+        }
+
+        auto [taken, added] = outputs.emplace(job.Output, index);
+        if (!added)
+        {
+            job.Error = "Tokens would overwrite those of "
+                        + jobs[taken->second].Input.string();
+        }
+    }
+
+    // Lex the largest files first, so the last to finish are small ones.
+    std::vector<size_t> order(jobs.size());
+    for (size_t index = 0; index < jobs.size(); index++)
+    {
+        std::error_code error;
+        jobs[index].Size = fs::file_size(jobs[index].Input, error);
+        jobs[index].Size = error ? 0 : jobs[index].Size;
+        order[index] = index;
+    }
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        return jobs[a].Size > jobs[b].Size;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> next = 0;
+    auto work = [&jobs, &order, &next]() {
+        for (size_t index = next++; index < order.size(); index = next++)
+        {
+            BatchJob& job = jobs[order[index]];
+            if (!job.Error.empty())
+            {
+                continue;
+            }
+
+            try
+            {
+                fs::create_directories(job.Output.parent_path());
+                job.Tokens = RunLexer(job.Input, job.Output);
+            }
+            catch (const std::exception& e)
+            {
+                job.Error = e.what();
+            }
+        }
+    };
+
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    threads = std::min(threads, std::max<size_t>(jobs.size(), 1));
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < threads; thread++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+
+    // Report files in the order they were given, not the order they were lexed.
+    uintmax_t bytes = 0;
+    size_t tokens = 0, failed = 0;
+    for (const BatchJob& job : jobs)
+    {
+        if (!job.Error.empty())
+        {
+            std::cout << job.Input.string() << ": " << job.Error << "\n";
+            failed++;
+            continue;
+        }
+        bytes += job.Size;
+        tokens += job.Tokens;
+    }
+
+    std::cout << "Lexed " << jobs.size() - failed << " files, " << bytes
+              << " bytes, " << tokens << " tokens in " << time.count()
+              << " s on " << threads << " threads\n";
+    return failed == 0;
+}
+
+/// <summary>
+/// Save how many times the lexer used each of its rules and states, so
+/// Plexiglass can lay the lexer out for inputs like the one it ran on.
+/// </summary>
+/// <param name="path">Path to the profile.</param>
+void SaveProfile(std::string path)
+{
+    std::ofstream out(path);
+    out << "plexiglass-profile b1d1fc199ff51068\n";
+    WriteProfile(out);
+}
+
+/// <summary>
+/// Main entry point for lexer driver code.
+/// </summary>
+/// <param name="argc">Number of command line parameters.</param>
+/// <param name="argv">Command line parameters.</param>
+/// <returns>
+/// 0 if the lexer ran, 1 if some of a batch's files couldn't be lexed, -1 if
+/// command line parameters were bad.
+/// </returns>
+int main(int argc, char** argv)
+{
+    argc--; // discard program name
+    argv++;
+
+    if (argc >= 3 && std::string_view(argv[0]) == "--batch")
+    {
+        std::vector<std::filesystem::path> inputs(argv + 2, argv + argc);
+        return RunBatch(argv[1], inputs) ? 0 : 1;
+    }
+
+    if (argc != 2 && argc != 3)
+    {
+        std::cout << "Invalid arguments. Call with input and output "
+                     "filenames, and optionally a profile to save, or with "
+                     "--batch, an output directory, and files and "
+                     "directories to lex.\n";
+        return -1;
+    }
+
+    std::string input = argv[0];
+    std::string output = argv[1];
+
+    RunLexer(input, output);
+    if (argc == 3)
+    {
+        SaveProfile(argv[2]);
+    }
+    return 0;
+}
+
+#endif
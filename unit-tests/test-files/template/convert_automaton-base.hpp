@@ -0,0 +1,302 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class LexerState;
+enum class Conversion;
+
+enum class TokenType
+{
+    __eof__,
+    __jam__,
+    __nothing__,
+    floatToken,
+    hexToken,
+    integerToken,
+};
+
+std::string ToString(TokenType type, std::string_view text);
+
+// A set of TokenTypes, indexed by their values, for choosing which tokens a
+// lexer produces.
+using TokenFilter =
+    std::bitset<static_cast<size_t>(TokenType::__nothing__) + 1>;
+
+// Arrays LexBatch() writes tokens into, one element per token. Any array can
+// be null if it isn't needed.
+struct TokenBatch
+{
+    TokenType* Types = nullptr;  // each token's type
+    size_t* Offsets = nullptr;   // where each token starts in the input
+    size_t* Lengths = nullptr;   // how long each token's text is
+    size_t* Lines = nullptr;     // the line each token ends on, as PeekLine()
+    size_t* Columns = nullptr;   // the column each token starts at
+    size_t* Symbols = nullptr;   // each token's symbol, if it was interned
+    int64_t* Integers = nullptr; // each token's integer value, if converted
+    double* Floats = nullptr;    // each token's float value, if converted
+};
+
+// Text interned by rules with the intern action, each distinct text numbered
+// in the order it was first seen. Text is copied into blocks that never move,
+// and found again through an open-addressing hash table.
+class SymbolTable
+{
+public:
+    size_t Intern(std::string_view text);
+    std::string_view Text(size_t symbol) const;
+    size_t Size() const;
+
+private:
+    // Where a symbol's text was copied to.
+    struct Entry
+    {
+        size_t Block;
+        size_t Offset;
+        size_t Length;
+        size_t Hash;
+    };
+
+    std::vector<std::vector<char>> m_blocks; // filled up to their capacity
+    std::vector<Entry> m_entries;            // by symbol
+
+    // Symbols plus one, with 0 for an empty slot. A power of two long, and
+    // never more than half full.
+    std::vector<size_t> m_slots;
+
+    void Grow();
+};
+
+// A token, as produced by iterating over a lexer.
+struct Token
+{
+    TokenType Type;
+    std::string_view Text;
+    size_t Line;
+};
+
+class TokenIterator;
+
+class convert_automaton
+{
+public:
+    // How many tokens past the next one can be peeked at.
+    static constexpr size_t lookahead = 0;
+
+    // The symbol of a token that wasn't interned.
+    static constexpr size_t no_symbol = static_cast<size_t>(-1);
+
+    // A token that's been lexed but not shifted past yet.
+    struct Lexed
+    {
+        TokenType Type;
+        size_t Offset;
+        size_t Length;
+        size_t Line;   // the line after its line actions, see PeekLine()
+        size_t Column; // the column the token starts at, on its first line
+        size_t Symbol;
+        int64_t Integer; // the value of a token converted to an integer
+        double Float;    // the value of any converted token
+    };
+
+    // Where the automaton stopped when fed input ran out.
+    struct ScanState
+    {
+        size_t State = 0;
+        size_t Length = 0;
+        size_t Matched = 0;
+        size_t Accept = 0;
+    };
+
+    // Where the lexer is in its input, and the tokens it's lexed ahead, so it
+    // can be put back there later. The tokens are kept rather than lexed again
+    // on Restore(), since lexing them again would need the state and line each
+    // one started in, and there are only lookahead + 1 of them.
+    struct Checkpoint
+    {
+        std::array<Lexed, lookahead + 1> Tokens;
+        size_t First;
+        size_t Count;
+        size_t Offset;
+        LexerState State;
+        size_t Line;
+        size_t LineStart;
+        ScanState Scan;
+    };
+
+    explicit convert_automaton(size_t maxTokenLength);
+    convert_automaton(const std::filesystem::path& path);
+    convert_automaton(std::istream& input,
+                size_t chunkSize = 65536,
+                size_t maxTokenLength = 4096);
+    convert_automaton(std::function<size_t(char*, size_t)> read,
+                size_t chunkSize = 65536,
+                size_t maxTokenLength = 4096);
+    static convert_automaton FromText(std::string_view input);
+    static convert_automaton FromText(const char* input);
+    static convert_automaton FromText(std::string&& input);
+    size_t PeekLine() const;
+    size_t PeekOffset() const;
+    size_t PeekColumn() const;
+    TokenType PeekToken() const;
+    std::string_view PeekText() const;
+    size_t PeekSymbol() const;
+    int64_t PeekInteger() const;
+    double PeekFloat() const;
+    TokenType PeekToken(size_t ahead);
+    std::string_view PeekText(size_t ahead);
+    size_t PeekSymbol(size_t ahead);
+    const SymbolTable& Symbols() const;
+    void Shift();
+    void Feed(std::string_view input);
+    bool Next();
+    void Finish();
+    size_t LexBatch(const TokenBatch& batch, size_t count);
+    void Filter(const TokenFilter& wanted);
+    Checkpoint Save() const;
+    void Restore(const Checkpoint& checkpoint);
+    TokenIterator begin();
+    TokenIterator end();
+
+private:
+    std::string m_reference;
+    std::string_view m_view;
+    LexerState m_state;
+    size_t m_line;
+    TokenType m_type;
+    size_t m_length; // length of the last token lexed, which ends at m_view
+    size_t m_offset = 0; // how far into the input m_view starts
+    size_t m_lineStart = 0; // offset of the byte after the last newline lexed
+    TokenFilter m_skipped; // TokenTypes lexed but not produced
+    bool m_intern = false; // whether the last token lexed is interned
+    Conversion m_convert{}; // what the last token lexed is converted to
+    SymbolTable m_symbols;
+
+    // The next token and the tokens after it that have been peeked at, in a
+    // ring starting at m_first. Their text is kept in the input until they're
+    // shifted past.
+    std::array<Lexed, lookahead + 1> m_tokens{};
+    size_t m_first = 0;
+    size_t m_count = 0;
+
+    // Where more input comes from, until it runs out. Only set when streaming.
+    std::function<size_t(char*, size_t)> m_read;
+    size_t m_chunkSize = 0;
+    size_t m_maxTokenLength = 0;
+
+    bool m_more = false; // whether more input may still be fed
+
+    ScanState m_scan;
+
+    // Sets the constructors for text apart from the path constructor, which
+    // strings and string literals would otherwise be ambiguous with.
+    struct TextInput
+    {
+    };
+
+    convert_automaton(TextInput, std::string_view input);
+    convert_automaton(TextInput, std::string&& input);
+    void Refill();
+    bool LexAhead();
+    bool ShiftHelper();
+    size_t Unshifted() const;
+};
+
+/// <summary>
+/// Iterates over a lexer's tokens, up to but not including __eof__. The
+/// lexer itself is advanced, so tokens can only be iterated over once.
+/// </summary>
+class TokenIterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Token;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Token;
+
+    /// <summary>
+    /// What post-incrementing returns: the token from before the increment.
+    /// </summary>
+    struct Previous
+    {
+        Token Value;
+
+        Token operator*() const
+        {
+            return Value;
+        }
+    };
+
+    TokenIterator() = default;
+
+    explicit TokenIterator(convert_automaton* lexer)
+        : m_lexer(lexer)
+    {
+    }
+
+    Token operator*() const
+    {
+        return { m_lexer->PeekToken(), m_lexer->PeekText(),
+                 m_lexer->PeekLine() };
+    }
+
+    TokenIterator& operator++()
+    {
+        m_lexer->Shift();
+        return *this;
+    }
+
+    Previous operator++(int)
+    {
+        Previous previous{ **this };
+        m_lexer->Shift();
+        return previous;
+    }
+
+    bool operator==(const TokenIterator& other) const
+    {
+        return AtEnd() == other.AtEnd();
+    }
+
+    bool operator!=(const TokenIterator& other) const
+    {
+        return AtEnd() != other.AtEnd();
+    }
+
+private:
+    convert_automaton* m_lexer = nullptr; // null for the end iterator
+
+    bool AtEnd() const
+    {
+        return !m_lexer || m_lexer->PeekToken() == TokenType::__eof__;
+    }
+};
+
+/// <summary>
+/// Start iterating over the lexer's tokens, from the next one.
+/// </summary>
+/// <returns>An iterator at the next token.</returns>
+inline TokenIterator convert_automaton::begin()
+{
+    return TokenIterator(this);
+}
+
+/// <summary>
+/// Get where iterating over the lexer's tokens stops, at __eof__.
+/// </summary>
+/// <returns>The end iterator.</returns>
+inline TokenIterator convert_automaton::end()
+{
+    return TokenIterator();
+}